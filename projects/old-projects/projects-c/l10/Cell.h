@@ -0,0 +1,8 @@
+#pragma once
+
+struct Cell
+{
+	Cell * right_Cell, *left_Cell, *up_Cell, *down_Cell;
+	bool value;
+	int distance;
+};
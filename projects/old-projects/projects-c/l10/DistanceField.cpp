@@ -0,0 +1,84 @@
+#include "DistanceField.h"
+#include <algorithm>
+#include <climits>
+#define INF (INT_MAX / 2)
+
+DistanceField::DistanceField() : rSize(0), cSize(0), source(0) {}
+
+int DistanceField::Lookahead(int cell) const
+{
+	if (!walkable[cell]) { return INF; }
+	if (cell == source) { return 0; }
+	int best = INF, r = cell / cSize, c = cell % cSize;
+	if (r > 0) { best = std::min(best, g[cell - cSize] + 1); }
+	if (r < rSize - 1) { best = std::min(best, g[cell + cSize] + 1); }
+	if (c > 0) { best = std::min(best, g[cell - 1] + 1); }
+	if (c < cSize - 1) { best = std::min(best, g[cell + 1] + 1); }
+	return std::min(best, INF);
+}
+
+void DistanceField::UpdateCell(int cell)
+{
+	rhs[cell] = Lookahead(cell);
+	if (g[cell] != rhs[cell]) { open.push({ std::min(g[cell], rhs[cell]), cell }); }
+}
+
+// Processes inconsistent cells in key order until none is left; returns how many cells were settled.
+int DistanceField::Repair()
+{
+	int settled = 0;
+	while (!open.empty())
+	{
+		Entry top = open.top();
+		open.pop();
+		int cell = top.second;
+		if (g[cell] == rhs[cell] || top.first != std::min(g[cell], rhs[cell])) { continue; } // stale entry
+		++settled;
+		if (g[cell] > rhs[cell]) { g[cell] = rhs[cell]; }
+		else
+		{
+			g[cell] = INF;
+			UpdateCell(cell);
+		}
+		int r = cell / cSize, c = cell % cSize;
+		if (r > 0) { UpdateCell(cell - cSize); }
+		if (r < rSize - 1) { UpdateCell(cell + cSize); }
+		if (c > 0) { UpdateCell(cell - 1); }
+		if (c < cSize - 1) { UpdateCell(cell + 1); }
+	}
+	return settled;
+}
+
+void DistanceField::Build(Cell * arr, int rSize, int cSize, int source)
+{
+	this->rSize = rSize;
+	this->cSize = cSize;
+	this->source = source;
+	walkable.resize(rSize * cSize);
+	for (int i = 0; i < rSize * cSize; ++i) { walkable[i] = arr[i].value; }
+	g.assign(rSize * cSize, INF);
+	rhs.assign(rSize * cSize, INF);
+	open = decltype(open)();
+	UpdateCell(source);
+	Repair();
+}
+
+int DistanceField::ToggleWall(int cell)
+{
+	walkable.at(cell) = !walkable.at(cell);
+	UpdateCell(cell);
+	return Repair();
+}
+
+int DistanceField::Distance(int cell) const { return g.at(cell) >= INF ? -1 : g.at(cell); }
+
+bool DistanceField::IsWall(int cell) const { return !walkable.at(cell); }
+
+void DistanceField::Apply(Cell * arr) const
+{
+	for (int i = 0; i < rSize * cSize; ++i)
+	{
+		arr[i].value = walkable[i] != 0;
+		arr[i].distance = Distance(i);
+	}
+}
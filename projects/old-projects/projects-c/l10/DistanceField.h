@@ -0,0 +1,33 @@
+#pragma once
+#include <queue>
+#include <utility>
+#include <vector>
+#include "Cell.h"
+
+//
+// Distance field from one source cell that can be repaired after walls change (LPA* without a heuristic).
+// Every cell keeps its current distance (g) and a one-step lookahead (rhs). A wall toggle only makes the
+// toggled cell inconsistent, so the repair touches nothing but the cells whose distance really changes.
+//
+
+class DistanceField
+{
+	typedef std::pair<int, int> Entry; // key, cell
+
+	int rSize, cSize, source;
+	std::vector<char> walkable;
+	std::vector<int> g, rhs;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+	int Lookahead(int cell) const;
+	void UpdateCell(int cell);
+	int Repair();
+
+public:
+	DistanceField();
+	void Build(Cell * arr, int rSize, int cSize, int source);
+	int ToggleWall(int cell);
+	int Distance(int cell) const;
+	bool IsWall(int cell) const;
+	void Apply(Cell * arr) const;
+};
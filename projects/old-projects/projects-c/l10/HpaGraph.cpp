@@ -0,0 +1,339 @@
+#include "HpaGraph.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <utility>
+#define HPA_MAGIC 0x31415048 // "HPA1"
+#define SINGLE_ENTRANCE_LIMIT 6 // shorter gaps get one transition in the middle, longer ones two at the ends
+
+HpaGraph::HpaGraph() : rSize(0), cSize(0), clusterSize(0), clusterRows(0), clusterCols(0) {}
+
+int HpaGraph::ClusterOf(int cell) const
+{
+	return (cell / cSize / clusterSize) * clusterCols + (cell % cSize) / clusterSize;
+}
+
+int HpaGraph::NodeCount() const { return static_cast<int>(nodeCell.size()); }
+
+int HpaGraph::AddNode(int cell, std::vector<int> * cellToNode)
+{
+	if (cellToNode->at(cell) >= 0) { return cellToNode->at(cell); }
+	int node = static_cast<int>(nodeCell.size());
+	nodeCell.push_back(cell);
+	edges.emplace_back();
+	clusterNodes.at(ClusterOf(cell)).push_back(node);
+	cellToNode->at(cell) = node;
+	return node;
+}
+
+void HpaGraph::AddEntrances(int cellA, int stepAlong, int stepAcross, int length, std::vector<int> * cellToNode)
+{
+	std::vector<int> offsets;
+	if (length < SINGLE_ENTRANCE_LIMIT) { offsets.push_back(length / 2); }
+	else
+	{
+		offsets.push_back(0);
+		offsets.push_back(length - 1);
+	}
+	for (int offset : offsets)
+	{
+		int a = AddNode(cellA + offset * stepAlong, cellToNode);
+		int b = AddNode(cellA + offset * stepAlong + stepAcross, cellToNode);
+		edges.at(a).push_back({ b, 1 });
+		edges.at(b).push_back({ a, 1 });
+	}
+}
+
+void HpaGraph::LocalDistances(int from, int cluster, std::vector<int> * distances) const
+{
+	int r0 = (cluster / clusterCols) * clusterSize, c0 = (cluster % clusterCols) * clusterSize;
+	int h = std::min(clusterSize, rSize - r0), w = std::min(clusterSize, cSize - c0);
+	distances->assign(w * h, -1);
+	std::queue<int> open;
+	int start = (from / cSize - r0) * w + (from % cSize - c0);
+	distances->at(start) = 0;
+	open.push(start);
+	while (!open.empty())
+	{
+		int local = open.front();
+		open.pop();
+		int r = local / w, c = local % w;
+		const int dr[] = { 0, 1, 0, -1 }, dc[] = { 1, 0, -1, 0 };
+		for (int k = 0; k < 4; ++k)
+		{
+			int nr = r + dr[k], nc = c + dc[k];
+			if (nr < 0 || nr >= h || nc < 0 || nc >= w) { continue; }
+			int next = nr * w + nc;
+			if (distances->at(next) >= 0 || !walkable[(r0 + nr) * cSize + c0 + nc]) { continue; }
+			distances->at(next) = distances->at(local) + 1;
+			open.push(next);
+		}
+	}
+}
+
+int HpaGraph::LocalSearch(int from, int to, int cluster, std::vector<int> * path) const
+{
+	std::vector<int> distances;
+	LocalDistances(to, cluster, &distances);
+	int r0 = (cluster / clusterCols) * clusterSize, c0 = (cluster % clusterCols) * clusterSize;
+	int h = std::min(clusterSize, rSize - r0), w = std::min(clusterSize, cSize - c0);
+	int local = (from / cSize - r0) * w + (from % cSize - c0);
+	int result = distances.at(local);
+	if (result < 0 || path == NULL) { return result; }
+	// walk downhill on the distance field towards the target
+	while (distances.at(local) > 0)
+	{
+		int r = local / w, c = local % w;
+		const int dr[] = { 0, 1, 0, -1 }, dc[] = { 1, 0, -1, 0 };
+		for (int k = 0; k < 4; ++k)
+		{
+			int nr = r + dr[k], nc = c + dc[k];
+			if (nr < 0 || nr >= h || nc < 0 || nc >= w) { continue; }
+			if (distances.at(nr * w + nc) == distances.at(local) - 1)
+			{
+				local = nr * w + nc;
+				break;
+			}
+		}
+		path->push_back((r0 + local / w) * cSize + c0 + local % w);
+	}
+	return result;
+}
+
+void HpaGraph::ConnectCluster(int cluster)
+{
+	const std::vector<int> & nodes = clusterNodes.at(cluster);
+	int r0 = (cluster / clusterCols) * clusterSize, c0 = (cluster % clusterCols) * clusterSize;
+	int w = std::min(clusterSize, cSize - c0);
+	std::vector<int> distances;
+	for (int a : nodes)
+	{
+		LocalDistances(nodeCell.at(a), cluster, &distances);
+		for (int b : nodes)
+		{
+			if (a == b) { continue; }
+			int d = distances.at((nodeCell.at(b) / cSize - r0) * w + (nodeCell.at(b) % cSize - c0));
+			if (d > 0) { edges.at(a).push_back({ b, d }); }
+		}
+	}
+}
+
+void HpaGraph::Build(Cell * arr, int rSize, int cSize, int clusterSize, int threads)
+{
+	this->rSize = rSize;
+	this->cSize = cSize;
+	this->clusterSize = clusterSize;
+	clusterRows = (rSize + clusterSize - 1) / clusterSize;
+	clusterCols = (cSize + clusterSize - 1) / clusterSize;
+	walkable.resize(rSize * cSize);
+	for (int i = 0; i < rSize * cSize; ++i) { walkable[i] = arr[i].value; }
+	nodeCell.clear();
+	edges.clear();
+	clusterNodes.assign(clusterRows * clusterCols, std::vector<int>());
+
+	// entrances are cheap to find, so this part stays sequential
+	std::vector<int> cellToNode(rSize * cSize, -1);
+	auto scanBorder = [&](int first, int stepAlong, int stepAcross, int length)
+	{
+		int runStart = -1;
+		for (int k = 0; k <= length; ++k)
+		{
+			int cell = first + k * stepAlong;
+			bool open = k < length && walkable[cell] && walkable[cell + stepAcross];
+			if (open && runStart < 0) { runStart = k; }
+			else if (!open && runStart >= 0)
+			{
+				AddEntrances(first + runStart * stepAlong, stepAlong, stepAcross, k - runStart, &cellToNode);
+				runStart = -1;
+			}
+		}
+	};
+	for (int cr = 0; cr < clusterRows; ++cr)
+	{
+		int r0 = cr * clusterSize, h = std::min(clusterSize, rSize - r0);
+		for (int cc = 0; cc < clusterCols; ++cc)
+		{
+			int c0 = cc * clusterSize, w = std::min(clusterSize, cSize - c0);
+			if (cc + 1 < clusterCols) { scanBorder(r0 * cSize + c0 + w - 1, cSize, 1, h); }
+			if (cr + 1 < clusterRows) { scanBorder((r0 + h - 1) * cSize + c0, 1, cSize, w); }
+		}
+	}
+
+	// intra-cluster distances; each worker only touches edges of nodes inside its own cluster
+	std::atomic<int> nextCluster(0);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < std::max(1, threads); ++t)
+	{
+		workers.emplace_back([this, &nextCluster]()
+		{
+			for (int cluster = nextCluster++; cluster < clusterRows * clusterCols; cluster = nextCluster++)
+			{
+				ConnectCluster(cluster);
+			}
+		});
+	}
+	for (auto & worker : workers) { worker.join(); }
+}
+
+bool HpaGraph::Matches(Cell * arr, int rSize, int cSize) const
+{
+	if (this->rSize != rSize || this->cSize != cSize) { return false; }
+	for (int i = 0; i < rSize * cSize; ++i)
+	{
+		if ((walkable[i] != 0) != arr[i].value) { return false; }
+	}
+	return true;
+}
+
+int HpaGraph::FindPath(int from, int to, std::vector<int> * path) const
+{
+	const int cells = static_cast<int>(walkable.size());
+	if (from < 0 || from >= cells || to < 0 || to >= cells || !walkable[from] || !walkable[to]) { return -1; }
+	if (from == to)
+	{
+		if (path != NULL) { path->push_back(from); }
+		return 0;
+	}
+	const int nodes = NodeCount(), start = nodes, goal = nodes + 1;
+	const int fromCluster = ClusterOf(from), toCluster = ClusterOf(to);
+
+	// temporary edges linking both ends to the entrances of their clusters
+	std::vector<Edge> startEdges;
+	std::vector<int> goalCost(nodes, -1), distances;
+	LocalDistances(from, fromCluster, &distances);
+	int c0 = (fromCluster % clusterCols) * clusterSize, w = std::min(clusterSize, cSize - c0);
+	int r0 = (fromCluster / clusterCols) * clusterSize;
+	for (int node : clusterNodes.at(fromCluster))
+	{
+		int d = distances.at((nodeCell[node] / cSize - r0) * w + (nodeCell[node] % cSize - c0));
+		if (d >= 0) { startEdges.push_back({ node, d }); }
+	}
+	if (fromCluster == toCluster)
+	{
+		int d = distances.at((to / cSize - r0) * w + (to % cSize - c0));
+		if (d >= 0) { startEdges.push_back({ goal, d }); }
+	}
+	LocalDistances(to, toCluster, &distances);
+	c0 = (toCluster % clusterCols) * clusterSize;
+	w = std::min(clusterSize, cSize - c0);
+	r0 = (toCluster / clusterCols) * clusterSize;
+	for (int node : clusterNodes.at(toCluster))
+	{
+		goalCost[node] = distances.at((nodeCell[node] / cSize - r0) * w + (nodeCell[node] % cSize - c0));
+	}
+
+	// A* over the abstract graph with the manhattan heuristic
+	auto cellOf = [&](int node) { return node == start ? from : node == goal ? to : nodeCell[node]; };
+	auto heuristic = [&](int node)
+	{
+		int cell = cellOf(node);
+		return std::abs(cell / cSize - to / cSize) + std::abs(cell % cSize - to % cSize);
+	};
+	std::vector<int> g(nodes + 2, -1), previous(nodes + 2, -1);
+	std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> open;
+	g[start] = 0;
+	open.push({ heuristic(start), start });
+	while (!open.empty())
+	{
+		int node = open.top().second, f = open.top().first;
+		open.pop();
+		if (node == goal) { break; }
+		if (f - heuristic(node) > g[node]) { continue; }
+		auto relax = [&](int next, int cost)
+		{
+			if (g[next] < 0 || g[node] + cost < g[next])
+			{
+				g[next] = g[node] + cost;
+				previous[next] = node;
+				open.push({ g[next] + heuristic(next), next });
+			}
+		};
+		if (node == start) { for (const Edge & edge : startEdges) { relax(edge.to, edge.cost); } }
+		else
+		{
+			for (const Edge & edge : edges[node]) { relax(edge.to, edge.cost); }
+			if (goalCost[node] >= 0) { relax(goal, goalCost[node]); }
+		}
+	}
+	if (g[goal] < 0 || path == NULL) { return g[goal]; }
+
+	// refine every abstract step into cells
+	std::vector<int> route;
+	for (int node = goal; node >= 0; node = previous[node]) { route.push_back(node); }
+	std::reverse(route.begin(), route.end());
+	path->push_back(from);
+	for (size_t k = 1; k < route.size(); ++k)
+	{
+		int a = cellOf(route[k - 1]), b = cellOf(route[k]);
+		if (ClusterOf(a) != ClusterOf(b)) { path->push_back(b); }
+		else { LocalSearch(a, b, ClusterOf(a), path); }
+	}
+	return g[goal];
+}
+
+bool HpaGraph::Save(const std::string & fileName) const
+{
+	std::fstream file(fileName, std::ios::out | std::ios::binary);
+	if (!file.good()) { return false; }
+	int header[] = { HPA_MAGIC, rSize, cSize, clusterSize, NodeCount() };
+	file.write(reinterpret_cast<const char *>(header), sizeof(header));
+	file.write(walkable.data(), walkable.size());
+	file.write(reinterpret_cast<const char *>(nodeCell.data()), nodeCell.size() * sizeof(int));
+	for (const auto & nodeEdges : edges)
+	{
+		int count = static_cast<int>(nodeEdges.size());
+		file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+		file.write(reinterpret_cast<const char *>(nodeEdges.data()), count * sizeof(Edge));
+	}
+	return file.good();
+}
+
+// Reads a graph saved for a map of rSize x cSize cut into clusters of clusterSize; false when the file was
+// saved for another map or cluster size, or is cut short or corrupt.
+bool HpaGraph::Load(const std::string & fileName, int rSize, int cSize, int clusterSize)
+{
+	std::fstream file(fileName, std::ios::in | std::ios::binary);
+	int header[5];
+	if (!file.read(reinterpret_cast<char *>(header), sizeof(header)) || header[0] != HPA_MAGIC
+		|| header[1] != rSize || header[2] != cSize || header[3] != clusterSize || clusterSize <= 0)
+	{
+		return false;
+	}
+	// no more entrances than cells, so the counts read can't ask for more memory than the map
+	int cells = rSize * cSize, nodes = header[4];
+	if (nodes < 0 || nodes > cells) { return false; }
+	this->rSize = this->cSize = 0;
+	this->clusterSize = clusterSize;
+	clusterRows = (rSize + clusterSize - 1) / clusterSize;
+	clusterCols = (cSize + clusterSize - 1) / clusterSize;
+	walkable.assign(cells, 0);
+	nodeCell.assign(nodes, 0);
+	edges.assign(nodes, std::vector<Edge>());
+	clusterNodes.assign(clusterRows * clusterCols, std::vector<int>());
+	if (!file.read(walkable.data(), walkable.size())
+		|| !file.read(reinterpret_cast<char *>(nodeCell.data()), nodeCell.size() * sizeof(int)))
+	{
+		return false;
+	}
+	for (int node = 0; node < nodes; ++node)
+	{
+		int count = 0;
+		if (!file.read(reinterpret_cast<char *>(&count), sizeof(count)) || count < 0 || count > nodes
+			|| nodeCell[node] < 0 || nodeCell[node] >= cells) { return false; }
+		edges[node].resize(count);
+		if (!file.read(reinterpret_cast<char *>(edges[node].data()), count * sizeof(Edge))) { return false; }
+		for (const Edge & edge : edges[node])
+		{
+			if (edge.to < 0 || edge.to >= nodes || edge.cost < 0 || edge.cost > cells) { return false; }
+		}
+	}
+	// only a graph read whole gets the dimensions, so Matches() fails after a partial read
+	this->rSize = rSize;
+	this->cSize = cSize;
+	for (int node = 0; node < nodes; ++node) { clusterNodes[ClusterOf(nodeCell[node])].push_back(node); }
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Cell.h"
+
+//
+// Hierarchical pathfinding (HPA*).
+// The map is split into square clusters. Every passable gap between two neighbouring clusters
+// gets one or two entrances, and the distances between entrances of the same cluster are
+// precomputed. A query runs A* on that small abstract graph and is then refined cluster by cluster.
+//
+// Build once, Save() the result and Load() it on the next run as long as Matches() the map; Load() only
+// takes a file saved for the same dimensions and cluster size.
+//
+
+class HpaGraph
+{
+	struct Edge
+	{
+		int to;
+		int cost;
+	};
+
+	int rSize, cSize, clusterSize;
+	int clusterRows, clusterCols;
+	std::vector<char> walkable;
+	std::vector<int> nodeCell;
+	std::vector<std::vector<Edge>> edges;
+	std::vector<std::vector<int>> clusterNodes;
+
+	int ClusterOf(int cell) const;
+	int AddNode(int cell, std::vector<int> * cellToNode);
+	void AddEntrances(int cellA, int stepAlong, int stepAcross, int length, std::vector<int> * cellToNode);
+	void ConnectCluster(int cluster);
+	int LocalSearch(int from, int to, int cluster, std::vector<int> * path) const;
+	void LocalDistances(int from, int cluster, std::vector<int> * distances) const;
+
+public:
+	HpaGraph();
+	void Build(Cell * arr, int rSize, int cSize, int clusterSize, int threads);
+	bool Matches(Cell * arr, int rSize, int cSize) const;
+	bool Save(const std::string & fileName) const;
+	bool Load(const std::string & fileName, int rSize, int cSize, int clusterSize);
+	int FindPath(int from, int to, std::vector<int> * path) const;
+	int NodeCount() const;
+};
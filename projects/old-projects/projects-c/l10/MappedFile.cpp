@@ -0,0 +1,93 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data(NULL), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL) {}
+
+bool MappedFile::Open(const std::string & fileName)
+{
+	Close();
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) { return false; }
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+	if (size == 0) { return true; }
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle != NULL) { data = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0)); }
+	if (data == NULL)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != NULL) { UnmapViewOfFile(data); }
+	if (mappingHandle != NULL) { CloseHandle(mappingHandle); }
+	if (fileHandle != INVALID_HANDLE_VALUE) { CloseHandle(fileHandle); }
+	data = NULL;
+	size = 0;
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : data(NULL), size(0), fileDescriptor(-1) {}
+
+bool MappedFile::Open(const std::string & fileName)
+{
+	Close();
+	fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) { return false; }
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0)
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(info.st_size);
+	if (size == 0) { return true; }
+	void * mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = static_cast<const char *>(mapping);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != NULL) { munmap(const_cast<char *>(data), size); }
+	if (fileDescriptor >= 0) { close(fileDescriptor); }
+	data = NULL;
+	size = 0;
+	fileDescriptor = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+const char * MappedFile::Data() const { return data; }
+
+size_t MappedFile::Size() const { return size; }
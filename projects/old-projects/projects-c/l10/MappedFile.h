@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+//
+// Read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap elsewhere).
+//
+
+class MappedFile
+{
+	const char * data;
+	size_t size;
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+public:
+	MappedFile();
+	~MappedFile();
+	bool Open(const std::string & fileName);
+	void Close();
+	const char * Data() const;
+	size_t Size() const;
+};
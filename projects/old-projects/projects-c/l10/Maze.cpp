@@ -0,0 +1,95 @@
+#include "Maze.h"
+#define RLIMIT 9
+
+void CreateConnection(Cell * cell, int i, bool up, bool down, bool left, bool right, int a, int b, int c, int d)
+{
+	cell[i].up_Cell = up ? &cell[a] : NULL;
+	cell[i].down_Cell = down ? &cell[b] : NULL;
+	cell[i].left_Cell = left ? &cell[c] : NULL;
+	cell[i].right_Cell = right ? &cell[d] : NULL;
+}
+
+bool CanGo(Cell * cell, std::vector<Cell*> vek)
+{
+	if (cell == NULL || cell->value == false) { return false; }
+	for (int i = 0; i < vek.size(); ++i){ if (cell == vek.at(i)) { return false; } }
+	return true;
+}
+
+void Go(Cell * cell, Cell * target, std::vector<Cell*> vek, int result, bool isFinished, int invokeCounter, int invokeLimit, int resultLimit, int * resultCounter)
+{
+	if (invokeCounter > invokeLimit) { return; }
+	++invokeCounter;
+	if (target->distance > 0 && target->distance < result && *resultCounter > resultLimit) { return; }
+	vek.push_back(cell);
+	if (cell == target)
+	{
+		++*resultCounter;
+		isFinished = true;
+		if (target->distance <= 0) { target->distance = result; }
+		else { target->distance = target->distance > result ? result : target->distance; }
+	}
+	if (isFinished == false)
+	{
+		++result;
+		if (CanGo(cell->right_Cell, vek))
+		{ Go(cell->right_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
+		if (CanGo(cell->down_Cell, vek))
+		{ Go(cell->down_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
+		if (CanGo(cell->left_Cell, vek))
+		{ Go(cell->left_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
+		if (CanGo(cell->up_Cell, vek)) { Go(cell->up_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
+	}
+}
+
+void SetPathLength(Cell * arr, int i, int invokeLimit)
+{
+	int resultCounter = 0;
+	bool isFinished = false;
+	std::vector<Cell *> tmpV;
+	Go(arr, &arr[i], tmpV, 0, isFinished, 0, invokeLimit, RLIMIT, &resultCounter);
+}
+
+void SetConnections(Cell * arr, int rSize, int cSize)
+{
+	for (int i = 0; i < (rSize * cSize); ++i)
+	{
+		if (arr[i].value == true)
+		{
+			if (i == 0) // top-left corner
+			{ CreateConnection(arr, i, false, true, false, true, NULL, cSize, NULL, 1); }
+			else if (i == cSize - 1) // top-right corner
+			{ CreateConnection(arr, i, false, true, true, false, NULL, i + cSize, i - 1, NULL); }
+			else if (i == cSize * (rSize - 1)) // bottom-left corner
+			{ CreateConnection(arr, i, true, false, false, true, i - cSize, NULL, NULL, i + 1); }
+			else if (i == rSize * cSize - 1) // bottom-right corner
+			{ CreateConnection(arr, i, true, false, true, false, i - cSize, NULL, i - 1, NULL); }
+			else if (i > 0 && i < cSize - 1) // top (except left & right corners)
+			{ CreateConnection(arr, i, false, true, true, true, NULL, i + cSize, i - 1, i + 1); }
+			else if (i > cSize * (rSize - 1) && i < rSize * cSize - 1) // bottom (except left & right corners)
+			{ CreateConnection(arr, i, true, false, true, true, i - cSize, NULL, i - 1, i + 1); }
+			else if (i > 0 && i < cSize * (rSize - 1) && i % cSize == 0) // left (except top & bottom corners)
+			{ CreateConnection(arr, i, true, true, false, true, i - cSize, i + cSize, NULL, i + 1); }
+			else if (i >(cSize - 1) && i < (cSize * rSize - 1) && ((i + 1) % cSize) == 0) // right (except top & bottom corners)
+			{ CreateConnection(arr, i, true, true, true, false, i - cSize, i + cSize, i - 1, NULL); }
+			else
+			{ CreateConnection(arr, i, true, true, true, true, i - cSize, i + cSize, i - 1, i + 1); }
+		}
+	}
+}
+
+void InitialValueAndDistance(Cell * arr, int rSize, int cSize)
+{
+	for (int j = 0; j < rSize * cSize; ++j)
+	{
+		arr[j].right_Cell = arr[j].left_Cell = arr[j].up_Cell = arr[j].down_Cell = NULL;
+		arr[j].value = false;
+		arr[j].distance = 0;
+	}
+}
+
+void SetupArrOfStructs(Cell * arr, const MazeBitmap & maze)
+{
+	InitialValueAndDistance(arr, maze.rSize, maze.cSize);
+	for (int j = 0; j < (maze.rSize * maze.cSize); ++j) { arr[j].value = maze.Walkable(j); }
+}
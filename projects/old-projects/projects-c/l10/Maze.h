@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include "Cell.h"
+#include "MazeBitmap.h"
+
+//
+// Cell array solver: cells are linked with their neighbours by SetConnections(), then SetPathLength()
+// searches every cell recursively from the top-left one and keeps the shortest distance found.
+//
+
+bool CanGo(Cell * cell, std::vector<Cell *> vek);
+
+void SetPathLength(Cell * arr, int i, int invokeLimit);
+
+void SetConnections(Cell * arr, int rSize, int cSize);
+
+void InitialValueAndDistance(Cell * arr, int rSize, int cSize);
+
+void SetupArrOfStructs(Cell * arr, const MazeBitmap & maze);
+
+void CreateConnection(Cell * cell, int i, bool up, bool down, bool left, bool right, int a, int b, int c, int d);
+
+void Go(Cell * cell, Cell * target, std::vector<Cell*> vek, int result,
+	bool isFinished, int invokeCounter, int invokeLimit, int resultLimit, int * resultCounter);
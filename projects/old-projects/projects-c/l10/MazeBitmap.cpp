@@ -0,0 +1,109 @@
+#include "MazeBitmap.h"
+#include "MappedFile.h"
+#include <bitset>
+#include <exception>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAZE_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define BLOCK 16
+
+static unsigned FirstBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static void PutBits(std::vector<uint64_t> * bits, long long at, uint64_t mask)
+{
+	if (mask == 0) { return; }
+	int shift = at & 63;
+	(*bits)[at >> 6] |= mask << shift;
+	if (shift > 64 - BLOCK) { (*bits)[(at >> 6) + 1] |= mask >> (64 - shift); }
+}
+
+static int ReadHeaderNumber(const char ** p, const char * end)
+{
+	int result = 0;
+	while (*p < end && (**p == ' ' || **p == '\t')) { ++*p; }
+	while (*p < end && **p >= '0' && **p <= '9') { result = result * 10 + (*(*p)++ - '0'); }
+	while (*p < end && *(*p)++ != '\n') {}
+	return result;
+}
+
+// Classifies up to BLOCK bytes of the current line; returns how many belong to it and sets the ground mask.
+static unsigned ScanBlock(const char * p, const char * end, char ch, unsigned * ground, bool * lineEnd)
+{
+#ifdef MAZE_SSE2
+	if (end - p >= BLOCK)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		unsigned newline = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+		*ground = _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(ch)));
+		if (newline == 0) { return BLOCK; }
+		unsigned take = FirstBit(newline);
+		*ground &= (1u << take) - 1;
+		*lineEnd = true;
+		return take;
+	}
+#endif
+	unsigned take = 0;
+	*ground = 0;
+	for (; take < BLOCK && p + take < end && p[take] != '\n'; ++take)
+	{
+		if (p[take] == ch) { *ground |= 1u << take; }
+	}
+	*lineEnd = take < BLOCK;
+	return take;
+}
+
+bool LoadMazeBitmap(const std::string & fileName, char ch, MazeBitmap * maze)
+{
+	MappedFile file;
+	if (!file.Open(fileName)) { return false; }
+	const char * p = file.Data(), * end = file.Data() + file.Size();
+	maze->rSize = ReadHeaderNumber(&p, end);
+	maze->cSize = ReadHeaderNumber(&p, end);
+	const long long cells = static_cast<long long>(maze->rSize) * maze->cSize;
+	maze->bits.assign(cells / 64 + 2, 0);
+
+	for (long long r = 0; r < maze->rSize && p < end; ++r)
+	{
+		long long length = 0;
+		bool lineEnd = false;
+		char last = 0;
+		while (!lineEnd)
+		{
+			unsigned ground;
+			unsigned take = ScanBlock(p, end, ch, &ground, &lineEnd);
+			long long inside = length < maze->cSize ? maze->cSize - length : 0;
+			if (inside < take && (ground >> inside) != 0)
+			{
+				throw new std::exception("Array is to small for provided data.");
+			}
+			PutBits(&maze->bits, r * maze->cSize + length, ground);
+			length += take;
+			if (take > 0) { last = p[take - 1]; }
+			p += take;
+			if (lineEnd && p < end) { ++p; }
+		}
+		// a windows line ending leaves one '\r' behind the row
+		if (length > maze->cSize && !(length == maze->cSize + 1 && last == '\r'))
+		{
+			throw new std::exception("Array is to small for provided data.");
+		}
+	}
+
+	long long ground = 0;
+	for (uint64_t word : maze->bits) { ground += std::bitset<64>(word).count(); }
+	maze->wallCount = cells - ground;
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// Packed walkable bitmap of a map file, bit (row * cSize + column) is set for ground.
+// The file is memory-mapped and every row is classified 16 bytes at a time in a single pass,
+// so nothing but the bitmap itself is allocated. Rows shorter than cSize are padded with walls.
+//
+
+struct MazeBitmap
+{
+	int rSize, cSize;
+	long long wallCount;
+	std::vector<uint64_t> bits;
+
+	bool Walkable(long long i) const { return (bits[i >> 6] >> (i & 63)) & 1; }
+};
+
+bool LoadMazeBitmap(const std::string & fileName, char ch, MazeBitmap * maze);
@@ -0,0 +1,200 @@
+#include "MazeGenerator.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#define ROOM_SIZE 8
+#define CAVE_SAMPLES 4096
+
+static unsigned long long Mix(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// Uniform value in [0, 1) that depends only on the seed and the position.
+static double Hash01(unsigned long long seed, long long a, long long b)
+{
+	return (Mix(Mix(seed ^ static_cast<unsigned long long>(a)) + static_cast<unsigned long long>(b)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double ValueNoise(unsigned long long seed, long long r, long long c, int spacing)
+{
+	long long gr = r / spacing, gc = c / spacing;
+	double fr = static_cast<double>(r % spacing) / spacing, fc = static_cast<double>(c % spacing) / spacing;
+	fr = fr * fr * (3 - 2 * fr);
+	fc = fc * fc * (3 - 2 * fc);
+	double top = Hash01(seed, gr, gc) * (1 - fc) + Hash01(seed, gr, gc + 1) * fc;
+	double bottom = Hash01(seed, gr + 1, gc) * (1 - fc) + Hash01(seed, gr + 1, gc + 1) * fc;
+	return top * (1 - fr) + bottom * fr;
+}
+
+static double CaveNoise(unsigned long long seed, long long r, long long c)
+{
+	return 0.65 * ValueNoise(seed, r, c, 16) + 0.35 * ValueNoise(seed + 1, r, c, 5);
+}
+
+static void RandomRow(std::string * row, long long r, double wallDensity, unsigned long long seed)
+{
+	for (long long c = 0; c < static_cast<long long>(row->size()); ++c) { (*row)[c] = Hash01(seed, r, c) < wallDensity ? '#' : '.'; }
+}
+
+static void CaveRow(std::string * row, long long r, double threshold, unsigned long long seed)
+{
+	for (long long c = 0; c < static_cast<long long>(row->size()); ++c) { (*row)[c] = CaveNoise(seed, r, c) < threshold ? '#' : '.'; }
+}
+
+static void RoomRow(std::string * row, long long r, double wallDensity, unsigned long long seed)
+{
+	const long long period = ROOM_SIZE + 1;
+	for (long long c = 0; c < static_cast<long long>(row->size()); ++c)
+	{
+		bool wallRow = r % period == ROOM_SIZE, wallColumn = c % period == ROOM_SIZE;
+		char cell;
+		if (wallRow && wallColumn) { cell = '#'; }
+		else if (wallRow) { cell = c % period == static_cast<long long>(Mix(seed ^ Mix(r / period * 2 + 0) ^ (c / period)) % ROOM_SIZE) ? '.' : '#'; }
+		else if (wallColumn) { cell = r % period == static_cast<long long>(Mix(seed ^ Mix(c / period * 2 + 1) ^ (r / period)) % ROOM_SIZE) ? '.' : '#'; }
+		else { cell = Hash01(seed, r, c) < wallDensity ? '#' : '.'; }
+		(*row)[c] = cell;
+	}
+}
+
+// Eller's algorithm: maze cells sit on even rows and columns, the odd ones hold the walls between them.
+class EllerRows
+{
+	std::vector<int> label, parent, lastIndex;
+	std::vector<char> right, down, hasDown;
+	long long cellRows, k;
+	double wallDensity;
+	unsigned long long state;
+
+	double Next()
+	{
+		state += 0x9E3779B97F4A7C15ULL;
+		return (Mix(state) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	int Find(int x)
+	{
+		while (parent[x] != x)
+		{
+			parent[x] = parent[parent[x]];
+			x = parent[x];
+		}
+		return x;
+	}
+
+public:
+	EllerRows(long long rSize, long long cSize, double wallDensity, unsigned long long seed)
+		: cellRows((rSize + 1) / 2), k(0), wallDensity(wallDensity), state(seed)
+	{
+		size_t m = static_cast<size_t>((cSize + 1) / 2);
+		label.resize(m);
+		parent.resize(m);
+		lastIndex.resize(m);
+		right.resize(m);
+		down.resize(m);
+		hasDown.resize(m);
+		for (size_t j = 0; j < m; ++j) { label[j] = static_cast<int>(j); }
+	}
+
+	// Fills the next cell row and the wall row below it.
+	void NextRows(std::string * cellRow, std::string * wallRow)
+	{
+		const int m = static_cast<int>(label.size());
+		const bool last = k == cellRows - 1;
+		for (int j = 0; j < m; ++j) { parent[j] = j; }
+		for (int j = 0; j + 1 < m; ++j)
+		{
+			int a = Find(label[j]), b = Find(label[j + 1]);
+			right[j] = a != b && (last || Next() < 0.5);
+			if (right[j]) { parent[b] = a; }
+		}
+		right[m - 1] = false;
+		// every set has to continue downwards at least once
+		for (int j = 0; j < m; ++j)
+		{
+			label[j] = Find(label[j]);
+			lastIndex[label[j]] = j;
+			hasDown[label[j]] = false;
+		}
+		for (int j = 0; j < m; ++j)
+		{
+			down[j] = !last && (Next() < 0.5 || (lastIndex[label[j]] == j && !hasDown[label[j]]));
+			if (down[j]) { hasDown[label[j]] = true; }
+		}
+
+		for (size_t c = 0; c < cellRow->size(); ++c)
+		{
+			bool open = c % 2 == 0 || right[c / 2] || (c / 2 + 1 < static_cast<size_t>(m) && Next() >= wallDensity);
+			(*cellRow)[c] = open ? '.' : '#';
+			open = c % 2 == 0 && (down[c / 2] || (!last && Next() >= wallDensity));
+			(*wallRow)[c] = open ? '.' : '#';
+		}
+
+		// sets that went down keep their label (renumbered), the other cells start new sets
+		std::vector<int> & renumber = lastIndex;
+		std::fill(renumber.begin(), renumber.end(), -1);
+		int nextLabel = 0;
+		for (int j = 0; j < m; ++j)
+		{
+			if (!down[j]) { continue; }
+			if (renumber[label[j]] < 0) { renumber[label[j]] = nextLabel++; }
+		}
+		for (int j = 0; j < m; ++j) { label[j] = down[j] ? renumber[label[j]] : nextLabel++; }
+		++k;
+	}
+};
+
+bool GenerateMaze(const std::string & fileName, long long rSize, long long cSize, MazeStructure structure,
+	double wallDensity, unsigned long long seed)
+{
+	std::ofstream file(fileName, std::ios::out | std::ios::binary);
+	if (!file.good() || rSize <= 0 || cSize <= 0) { return false; }
+	file << rSize << "\n" << cSize << "\n";
+
+	double threshold = 0;
+	if (structure == MazeStructure::CAVES)
+	{
+		// noise is not uniform, so cut it at the sampled quantile to hit the density
+		std::vector<double> samples(CAVE_SAMPLES);
+		for (int s = 0; s < CAVE_SAMPLES; ++s)
+		{
+			samples[s] = CaveNoise(seed, static_cast<long long>(Hash01(seed, -1, s) * rSize), static_cast<long long>(Hash01(seed, -2, s) * cSize));
+		}
+		std::sort(samples.begin(), samples.end());
+		threshold = wallDensity <= 0 ? -1 : samples[std::min(CAVE_SAMPLES - 1, static_cast<int>(wallDensity * CAVE_SAMPLES))];
+	}
+
+	EllerRows eller(rSize, cSize, wallDensity, seed);
+	std::string row(static_cast<size_t>(cSize), '.'), wallRow(static_cast<size_t>(cSize), '#');
+	for (long long r = 0; r < rSize; ++r)
+	{
+		switch (structure)
+		{
+		case MazeStructure::RANDOM: RandomRow(&row, r, wallDensity, seed); break;
+		case MazeStructure::CAVES: CaveRow(&row, r, threshold, seed); break;
+		case MazeStructure::ROOMS: RoomRow(&row, r, wallDensity, seed); break;
+		case MazeStructure::PERFECT:
+			if (r % 2 == 0) { eller.NextRows(&row, &wallRow); }
+			else { row.swap(wallRow); }
+			break;
+		}
+		if (r == 0) { row[0] = '.'; }
+		file.write(row.data(), row.size());
+		file.put('\n');
+		if (structure == MazeStructure::PERFECT && r % 2 == 1) { row.swap(wallRow); }
+	}
+	return file.good();
+}
+
+bool ParseMazeStructure(const std::string & name, MazeStructure * structure)
+{
+	if (name == "random") { *structure = MazeStructure::RANDOM; }
+	else if (name == "perfect") { *structure = MazeStructure::PERFECT; }
+	else if (name == "caves") { *structure = MazeStructure::CAVES; }
+	else if (name == "rooms") { *structure = MazeStructure::ROOMS; }
+	else { return false; }
+	return true;
+}
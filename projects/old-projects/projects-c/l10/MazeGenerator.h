@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+
+//
+// Random map files in the format of the "test" directory. Rows are generated and written one at a time,
+// so memory depends only on the column count and maps far bigger than RAM can be produced.
+//
+// RANDOM  - every cell is a wall with probability wallDensity
+// PERFECT - maze with exactly one path between any two cells (Eller's algorithm); wallDensity is the share
+//           of dividing walls that stay, lower values open loops
+// CAVES   - smooth value noise cut at the wallDensity quantile
+// ROOMS   - rooms separated by walls with one door per side, wallDensity of every room filled with pillars
+//
+// The top-left cell is always ground.
+//
+
+enum class MazeStructure { RANDOM, PERFECT, CAVES, ROOMS };
+
+bool GenerateMaze(const std::string & fileName, long long rSize, long long cSize, MazeStructure structure,
+	double wallDensity, unsigned long long seed);
+
+bool ParseMazeStructure(const std::string & name, MazeStructure * structure);
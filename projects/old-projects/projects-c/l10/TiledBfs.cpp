@@ -0,0 +1,226 @@
+#include "TiledBfs.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+TiledBfs::TiledBfs(int tileSize, int cacheTiles)
+	: rSize(0), cSize(0), tileSize((std::max(tileSize, 8) + 7) / 8 * 8), tileRows(0), tileCols(0),
+	cacheTiles(std::max(cacheTiles, 1)), bytesRead(0), bytesWritten(0) {}
+
+// The tile file is scratch space: it goes away with the tiles still cached, so nothing here can fail.
+TiledBfs::~TiledBfs()
+{
+	file.close();
+	if (!tileFileName.empty()) { std::remove(tileFileName.c_str()); }
+}
+
+long long TiledBfs::BitmapBytes() const { return static_cast<long long>(tileSize) * tileSize / 8; }
+
+long long TiledBfs::SlotBytes() const { return BitmapBytes() + static_cast<long long>(tileSize) * tileSize * sizeof(int); }
+
+long long TiledBfs::Rows() const { return rSize; }
+
+long long TiledBfs::Columns() const { return cSize; }
+
+long long TiledBfs::BytesRead() const { return bytesRead; }
+
+long long TiledBfs::BytesWritten() const { return bytesWritten; }
+
+void TiledBfs::WriteTile(const Tile & tile)
+{
+	file.seekp(tile.index * SlotBytes());
+	file.write(reinterpret_cast<const char *>(tile.walkable.data()), BitmapBytes());
+	file.write(reinterpret_cast<const char *>(tile.distance.data()), tile.distance.size() * sizeof(int));
+	if (!file.good()) { throw new std::exception("TiledBfs - can't write tile file."); }
+	bytesWritten += SlotBytes();
+}
+
+TiledBfs::Tile & TiledBfs::Fetch(int index)
+{
+	auto found = cached.find(index);
+	if (found != cached.end())
+	{
+		cache.splice(cache.begin(), cache, found->second);
+		return cache.front();
+	}
+	if (static_cast<int>(cache.size()) >= cacheTiles)
+	{
+		// reuse the buffers of the least recently used tile
+		Tile & victim = cache.back();
+		if (victim.dirty) { WriteTile(victim); }
+		cached.erase(victim.index);
+		cache.splice(cache.begin(), cache, std::prev(cache.end()));
+	}
+	else
+	{
+		cache.push_front(Tile());
+		cache.front().walkable.resize(BitmapBytes() / 8);
+		cache.front().distance.resize(tileSize * tileSize);
+	}
+	Tile & tile = cache.front();
+	tile.index = index;
+	tile.dirty = false;
+	file.seekg(index * SlotBytes());
+	file.read(reinterpret_cast<char *>(tile.walkable.data()), BitmapBytes());
+	file.read(reinterpret_cast<char *>(tile.distance.data()), tile.distance.size() * sizeof(int));
+	if (!file.good()) { throw new std::exception("TiledBfs - can't read tile file."); }
+	bytesRead += SlotBytes();
+	cached[index] = cache.begin();
+	return tile;
+}
+
+void TiledBfs::Flush()
+{
+	for (Tile & tile : cache)
+	{
+		if (!tile.dirty) { continue; }
+		WriteTile(tile);
+		tile.dirty = false;
+	}
+	if (file.is_open()) { file.flush(); }
+}
+
+bool TiledBfs::Import(const std::string & mapFileName, const std::string & tileFileName, char ch)
+{
+	std::ifstream map(mapFileName);
+	if (!map.good()) { return false; }
+	std::string line;
+	std::getline(map, line);
+	rSize = atoll(line.c_str());
+	std::getline(map, line);
+	cSize = atoll(line.c_str());
+	tileRows = static_cast<int>((rSize + tileSize - 1) / tileSize);
+	tileCols = static_cast<int>((cSize + tileSize - 1) / tileSize);
+	cache.clear();
+	cached.clear();
+	file.close();
+	if (!this->tileFileName.empty() && this->tileFileName != tileFileName) { std::remove(this->tileFileName.c_str()); }
+	this->tileFileName = tileFileName;
+	file.open(tileFileName, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.good()) { return false; }
+
+	// one band of tiles is built in memory while the rows stream in
+	std::vector<Tile> band(tileCols);
+	for (Tile & tile : band)
+	{
+		tile.walkable.assign(BitmapBytes() / 8, 0);
+		tile.distance.assign(tileSize * tileSize, -1);
+	}
+	for (long long r = 0; r < static_cast<long long>(tileRows) * tileSize; ++r)
+	{
+		if (r < rSize && std::getline(map, line))
+		{
+			if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+			if (static_cast<long long>(line.length()) > cSize) { throw new std::exception("Array is to small for provided data."); }
+			int local = static_cast<int>(r % tileSize) * tileSize;
+			for (size_t c = 0; c < line.length(); ++c)
+			{
+				if (line[c] != ch) { continue; }
+				int bit = local + static_cast<int>(c % tileSize);
+				band[c / tileSize].walkable[bit >> 6] |= 1ULL << (bit & 63);
+			}
+		}
+		if (r % tileSize == tileSize - 1)
+		{
+			for (int tc = 0; tc < tileCols; ++tc)
+			{
+				band[tc].index = static_cast<int>(r / tileSize) * tileCols + tc;
+				WriteTile(band[tc]);
+				std::fill(band[tc].walkable.begin(), band[tc].walkable.end(), 0);
+			}
+		}
+	}
+	file.flush();
+	return true;
+}
+
+long long TiledBfs::Run(long long source, int * maxDistance)
+{
+	*maxDistance = -1;
+	if (rSize == 0 || cSize == 0) { return 0; } // a map without cells has no tiles
+	const int tileCount = tileRows * tileCols;
+	std::vector<std::vector<int>> frontier(tileCount), next(tileCount);
+	auto tileOf = [&](long long r, long long c) { return static_cast<int>(r / tileSize) * tileCols + static_cast<int>(c / tileSize); };
+	auto localOf = [&](long long r, long long c) { return static_cast<int>(r % tileSize) * tileSize + static_cast<int>(c % tileSize); };
+	frontier[tileOf(source / cSize, source % cSize)].push_back(localOf(source / cSize, source % cSize));
+	long long reached = 0;
+
+	for (int layer = 0, pending = 1; pending > 0; ++layer)
+	{
+		pending = 0;
+		for (int t = 0; t < tileCount; ++t)
+		{
+			if (frontier[t].empty()) { continue; }
+			// cells pushed from a neighbouring tile can duplicate cells found inside this one
+			std::sort(frontier[t].begin(), frontier[t].end());
+			frontier[t].erase(std::unique(frontier[t].begin(), frontier[t].end()), frontier[t].end());
+			Tile & tile = Fetch(t);
+			long long r0 = static_cast<long long>(t / tileCols) * tileSize, c0 = static_cast<long long>(t % tileCols) * tileSize;
+			for (int local : frontier[t])
+			{
+				if (tile.distance[local] == -1 && ((tile.walkable[local >> 6] >> (local & 63)) & 1))
+				{
+					tile.distance[local] = layer;
+					tile.dirty = true;
+				}
+				else if (tile.distance[local] != layer) { continue; }
+				++reached;
+				*maxDistance = layer;
+				const int dr[] = { 0, 1, 0, -1 }, dc[] = { 1, 0, -1, 0 };
+				for (int k = 0; k < 4; ++k)
+				{
+					long long r = r0 + local / tileSize + dr[k], c = c0 + local % tileSize + dc[k];
+					if (r < 0 || r >= rSize || c < 0 || c >= cSize) { continue; }
+					int nextTile = tileOf(r, c), nextLocal = localOf(r, c);
+					if (nextTile != t) { next[nextTile].push_back(nextLocal); }
+					else if (tile.distance[nextLocal] == -1 && ((tile.walkable[nextLocal >> 6] >> (nextLocal & 63)) & 1))
+					{
+						tile.distance[nextLocal] = layer + 1;
+						tile.dirty = true;
+						next[t].push_back(nextLocal);
+					}
+					else { continue; }
+					++pending;
+				}
+			}
+			std::vector<int>().swap(frontier[t]);
+		}
+		std::swap(frontier, next);
+	}
+	Flush();
+	return reached;
+}
+
+int TiledBfs::Distance(long long cell)
+{
+	if (rSize == 0 || cSize == 0) { return -1; }
+	long long r = cell / cSize, c = cell % cSize;
+	Tile & tile = Fetch(static_cast<int>(r / tileSize) * tileCols + static_cast<int>(c / tileSize));
+	return tile.distance[static_cast<int>(r % tileSize) * tileSize + static_cast<int>(c % tileSize)];
+}
+
+long long TiledBfs::PeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+	return static_cast<long long>(counters.PeakWorkingSetSize);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024LL;
+#endif
+#endif
+}
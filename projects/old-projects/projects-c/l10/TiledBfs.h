@@ -0,0 +1,53 @@
+#pragma once
+#include <fstream>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// Out-of-core BFS for maps that do not fit in memory.
+// Import() streams a map file into a tile file: square tiles, each a packed walkable bitmap followed by
+// its distances. Run() then expands the BFS one layer at a time, visiting only the tiles that have cells
+// in the current frontier. Tiles are kept in a small LRU cache and written back when evicted, so memory
+// stays at about cacheTiles tiles plus the frontier. The cache should hold the whole BFS wavefront
+// (roughly tile rows + tile columns), otherwise every layer reloads the same tiles.
+// Run() writes the tiles back when it is done; the tile file is removed when the TiledBfs is destroyed.
+//
+
+class TiledBfs
+{
+	struct Tile
+	{
+		int index;
+		bool dirty;
+		std::vector<unsigned long long> walkable;
+		std::vector<int> distance;
+	};
+
+	std::fstream file;
+	std::string tileFileName;
+	long long rSize, cSize;
+	int tileSize, tileRows, tileCols, cacheTiles;
+	std::list<Tile> cache;
+	std::unordered_map<int, std::list<Tile>::iterator> cached;
+	long long bytesRead, bytesWritten;
+
+	long long BitmapBytes() const;
+	long long SlotBytes() const;
+	void WriteTile(const Tile & tile);
+	Tile & Fetch(int index);
+
+public:
+	TiledBfs(int tileSize, int cacheTiles);
+	~TiledBfs();
+	bool Import(const std::string & mapFileName, const std::string & tileFileName, char ch);
+	long long Run(long long source, int * maxDistance);
+	int Distance(long long cell);
+	void Flush();
+	long long Rows() const;
+	long long Columns() const;
+	long long BytesRead() const;
+	long long BytesWritten() const;
+	static long long PeakMemory();
+};
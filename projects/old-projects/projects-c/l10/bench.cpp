@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Maze.h"
+#include "MazeBitmap.h"
+#include "MazeGenerator.h"
+#include "DistanceField.h"
+#include "HpaGraph.h"
+#include "TiledBfs.h"
+#define RECURSIVE_LIMIT 100 // the recursive solver is exponential, bigger maps never finish
+#define HPA_CLUSTER_SIZE 16
+#define HPA_QUERIES 100
+#define TILE_SIZE 256
+#define CACHE_TILES 64
+
+//
+// Scaling benchmark for the l10 engines, built separately from main.cpp.
+// Usage: bench [max exponent = 7] [random|perfect|caves|rooms] [wall density = 0.3] [memory budget in MB = 4096]
+// For every size 10^2 .. 10^max cells a map is generated and each engine is timed on it:
+// load (file -> bitmap or tiles), build (cell array, connections, abstract graph) and distance computation.
+// Engines that would not fit in the memory budget are skipped.
+//
+
+double Seconds(const std::function<void()> & work)
+{
+	auto start = std::chrono::steady_clock::now();
+	work();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Report(const char * engine, long long cells, double load, double build, double distance)
+{
+	printf("%12lld  %-10s %10.4f %10.4f %10.4f %14.0f\n", cells, engine, load, build, distance,
+		cells / std::max(load + build + distance, 1e-9));
+}
+
+int main(int argc, char * argv[])
+{
+	const char CHAR = '.';
+	const std::string mapName = "bench_map.txt";
+	int maxExponent = argc > 1 ? atoi(argv[1]) : 7;
+	MazeStructure structure = MazeStructure::RANDOM;
+	if (argc > 2 && !ParseMazeStructure(argv[2], &structure))
+	{
+		std::cout << "Unknown structure " << argv[2] << std::endl;
+		return 1;
+	}
+	double wallDensity = argc > 3 ? atof(argv[3]) : 0.3;
+	long long budget = (argc > 4 ? atoll(argv[4]) : 4096) * 1024 * 1024;
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+
+	printf("%12s  %-10s %10s %10s %10s %14s\n", "cells", "engine", "load [s]", "build [s]", "dist [s]", "cells/s");
+	for (int exponent = 2; exponent <= maxExponent; ++exponent)
+	{
+		long long cells = 1;
+		for (int e = 0; e < exponent; ++e) { cells *= 10; }
+		long long rSize = 1;
+		for (int e = 0; e < exponent / 2; ++e) { rSize *= 10; }
+		long long cSize = cells / rSize;
+		if (!GenerateMaze(mapName, rSize, cSize, structure, wallDensity, exponent))
+		{
+			std::cout << "Can't write " << mapName << std::endl;
+			return 1;
+		}
+
+		// in-memory engines share one load
+		bool inMemory = cells < 0x7FFFFFFF && cells * static_cast<long long>(sizeof(Cell) + 2 * sizeof(int) + 1) <= budget;
+		if (inMemory)
+		{
+			MazeBitmap maze;
+			double load = Seconds([&]() { LoadMazeBitmap(mapName, CHAR, &maze); });
+			std::vector<Cell> arr(static_cast<size_t>(cells));
+			double setup = Seconds([&]() { SetupArrOfStructs(arr.data(), maze); });
+
+			if (cells <= RECURSIVE_LIMIT)
+			{
+				double build = Seconds([&]() { SetConnections(arr.data(), maze.rSize, maze.cSize); });
+				double distance = Seconds([&]()
+				{
+					for (int j = 0; j < cells; ++j)
+					{
+						SetPathLength(arr.data(), j, static_cast<int>(rSize + cSize + maze.wallCount));
+					}
+				});
+				Report("recursive", cells, load, setup + build, distance);
+			}
+
+			DistanceField field;
+			double distance = Seconds([&]() { field.Build(arr.data(), maze.rSize, maze.cSize, 0); });
+			Report("lpa", cells, load, setup, distance);
+
+			HpaGraph graph;
+			double build = Seconds([&]() { graph.Build(arr.data(), maze.rSize, maze.cSize, HPA_CLUSTER_SIZE, threads); });
+			std::mt19937 random(exponent);
+			distance = Seconds([&]()
+			{
+				for (int q = 0; q < HPA_QUERIES; ++q)
+				{
+					graph.FindPath(static_cast<int>(random() % cells), static_cast<int>(random() % cells), NULL);
+				}
+			});
+			Report("hpa", cells, load, setup + build, distance);
+		}
+
+		{
+			TiledBfs bfs(TILE_SIZE, CACHE_TILES);
+			int maxDistance = 0;
+			double load = Seconds([&]() { bfs.Import(mapName, mapName + ".tiles", CHAR); });
+			double distance = Seconds([&]() { bfs.Run(0, &maxDistance); });
+			Report("tiled", cells, load, 0, distance);
+		}
+	}
+	remove(mapName.c_str());
+	return 0;
+}
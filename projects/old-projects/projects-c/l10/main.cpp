@@ -1,9 +1,24 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
-#define RLIMIT 9
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "Maze.h"
+#include "HpaGraph.h"
+#include "DistanceField.h"
+#include "MazeBitmap.h"
+#include "TiledBfs.h"
+#include "MazeGenerator.h"
+#define HPA_CLUSTER_SIZE 16
+#define TILE_SIZE 256
+#define CACHE_TILES 64
 
 //
 // Files in directory "test" must be numbered according to the formula: 0, 1, 2, 3, ..., n.
@@ -19,227 +34,203 @@
 //
 // Where '#' is wall, '.' is ground (possible to pass)
 //
+// The abstract HPA* graph of every map is cached next to it as "n.hpa" and rebuilt when the map changes.
+//
+// Optional file "n.edits" toggles walls after the first run, one "row column" pair per line (counted from 0).
+// Distances are repaired after every toggle instead of being computed again for the whole map.
+//
+// Maps are solved in parallel, each into its own buffer, and printed in file order.
+//
+// Maps too big for memory: "l10 --out-of-core <map file> [tile size] [cached tiles]" runs a tiled BFS from the
+// top-left cell through "<map file>.tiles" on disk and reports the distances, tile I/O and peak memory.
+//
+// "l10 --generate <map file> <rows> <columns> [random|perfect|caves|rooms] [wall density] [seed]" writes a random map.
+// Scaling numbers for all engines come from the separate bench.cpp target.
+//
 
-struct Cell
-{
-	Cell * right_Cell, *left_Cell, *up_Cell, *down_Cell;
-	bool value;
-	int distance;
-};
-
-bool CanGo(Cell * cell, std::vector<Cell *> vek);
-
-std::string LoadContentString(std::fstream * file, int cSize);
-
-std::string ContentConverter(std::fstream * file, int cSize, char ch);
-
-void PrintDistances(Cell * arr, int rSize, int cSize);
-
-void PrintMap(Cell * arr, int rSize, int cSize, char ch);
-
-void SetPathLength(Cell * arr, int i, int invokeLimit);
+void PrintDistances(Cell * arr, int rSize, int cSize, std::ostream & out);
 
-void SetConnections(Cell * arr, int rSize, int cSize);
+void PrintMap(Cell * arr, int rSize, int cSize, char ch, std::ostream & out);
 
-void InitialValueAndDistance(Cell * arr, int rSize, int cSize);
+void PrintHpaPath(Cell * arr, int rSize, int cSize, const std::string & cacheName, int threads, std::ostream & out);
 
-void SetupArrOfStructs(Cell * arr, int rSize, int cSize, int * wallCount, std::fstream * file, char ch);
+void ApplyWallEdits(Cell * arr, int rSize, int cSize, const std::string & editsName, char ch, std::ostream & out);
 
-void GetMatrixSizes(int * rSize, int * cSize, std::fstream * file);
+void SolveFile(int i, char ch, int threads, std::ostream & out);
 
-void CreateConnection(Cell * cell, int i, bool up, bool down, bool left, bool right, int a, int b, int c, int d);
+void RunBatch(int count, char ch, int workers, std::ostream & out);
 
-void Go(Cell * cell, Cell * target, std::vector<Cell*> vek, int result,
-	bool isFinished, int invokeCounter, int invokeLimit, int resultLimit, int * resultCounter);
+int RunOutOfCore(const std::string & mapFileName, char ch, int tileSize, int cacheTiles);
 
-int main()
+int main(int argc, char * argv[])
 {
 	const char CHAR = '.';
-	std::fstream file;
-	std::string tmp = "error message"; // this "error message" can be helpful to find errors
-	bool fileGood = true;
-	int rSize = 0, cSize = 0;
-	for (int i = 0; fileGood; ++i)
+	if (argc > 2 && std::string(argv[1]) == "--out-of-core")
 	{
-		file.open("../test/" + std::to_string(i) + ".txt", std::ios::in);
-		if (file.good())
-		{
-			int wallCount = 0;
-			std::cout << "FILE: " << i << ".txt" << std::endl;
-			GetMatrixSizes(&rSize, &cSize, &file);
-			auto * arrayOfCells = new Cell[rSize * cSize];
-			SetupArrOfStructs(arrayOfCells, rSize, cSize, &wallCount, &file, CHAR);
-			PrintMap(arrayOfCells, rSize, cSize, CHAR);
-			SetConnections(arrayOfCells, rSize, cSize);
-			for (int j = 0; j < rSize*cSize; ++j)
-			{
-				SetPathLength(arrayOfCells, j, rSize + cSize + wallCount);
-			}
-			PrintDistances(arrayOfCells, rSize, cSize);
-			std::cout << std::endl << std::endl;
-			// end work with file & delete array
-			delete[] arrayOfCells;
-			file.close();
-		}
-		else { fileGood = false; }
+		return RunOutOfCore(argv[2], CHAR, argc > 3 ? atoi(argv[3]) : TILE_SIZE, argc > 4 ? atoi(argv[4]) : CACHE_TILES);
+	}
+	if (argc > 4 && std::string(argv[1]) == "--generate")
+	{
+		MazeStructure structure = MazeStructure::RANDOM;
+		if (argc > 5 && !ParseMazeStructure(argv[5], &structure)) { std::cout << "Unknown structure " << argv[5] << std::endl; }
+		else if (GenerateMaze(argv[2], atoll(argv[3]), atoll(argv[4]), structure, argc > 6 ? atof(argv[6]) : 0.3, argc > 7 ? atoll(argv[7]) : 0)) { return 0; }
+		return 1;
 	}
+	int count = 0;
+	while (std::ifstream("../test/" + std::to_string(count) + ".txt").good()) { ++count; }
+	RunBatch(count, CHAR, std::thread::hardware_concurrency(), std::cout);
 	return 0;
 }
 
-void CreateConnection(Cell * cell, int i, bool up, bool down, bool left, bool right, int a, int b, int c, int d)
-{
-	cell[i].up_Cell = up ? &cell[a] : NULL;
-	cell[i].down_Cell = down ? &cell[b] : NULL;
-	cell[i].left_Cell = left ? &cell[c] : NULL;
-	cell[i].right_Cell = right ? &cell[d] : NULL;
-}
-
-bool CanGo(Cell * cell, std::vector<Cell*> vek)
-{
-	if (cell == NULL || cell->value == false) { return false; }
-	for (int i = 0; i < vek.size(); ++i){ if (cell == vek.at(i)) { return false; } }
-	return true;
-}
-
-void Go(Cell * cell, Cell * target, std::vector<Cell*> vek, int result, bool isFinished, int invokeCounter, int invokeLimit, int resultLimit, int * resultCounter)
+void SolveFile(int i, char ch, int threads, std::ostream & out)
 {
-	if (invokeCounter > invokeLimit) { return; }
-	++invokeCounter;
-	if (target->distance > 0 && target->distance < result && *resultCounter > resultLimit) { return; }
-	vek.push_back(cell);
-	if (cell == target)
-	{
-		++*resultCounter;
-		isFinished = true;
-		if (target->distance <= 0) { target->distance = result; }
-		else { target->distance = target->distance > result ? result : target->distance; }
-	}
-	if (isFinished == false)
+	MazeBitmap maze;
+	std::string tmp = "error message"; // this "error message" can be helpful to find errors
+	if (!LoadMazeBitmap("../test/" + std::to_string(i) + ".txt", ch, &maze)) { return; }
+	int wallCount = static_cast<int>(maze.wallCount);
+	int rSize = maze.rSize, cSize = maze.cSize;
+	out << "FILE: " << i << ".txt" << std::endl;
+	auto * arrayOfCells = new Cell[rSize * cSize];
+	SetupArrOfStructs(arrayOfCells, maze);
+	PrintMap(arrayOfCells, rSize, cSize, ch, out);
+	SetConnections(arrayOfCells, rSize, cSize);
+	for (int j = 0; j < rSize*cSize; ++j)
 	{
-		++result;
-		if (CanGo(cell->right_Cell, vek))
-		{ Go(cell->right_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
-		if (CanGo(cell->down_Cell, vek))
-		{ Go(cell->down_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
-		if (CanGo(cell->left_Cell, vek))
-		{ Go(cell->left_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
-		if (CanGo(cell->up_Cell, vek)) { Go(cell->up_Cell, target, vek, result, isFinished, invokeCounter, invokeLimit, resultLimit, resultCounter); }
+		SetPathLength(arrayOfCells, j, rSize + cSize + wallCount);
 	}
+	PrintDistances(arrayOfCells, rSize, cSize, out);
+	PrintHpaPath(arrayOfCells, rSize, cSize, "../test/" + std::to_string(i) + ".hpa", threads, out);
+	ApplyWallEdits(arrayOfCells, rSize, cSize, "../test/" + std::to_string(i) + ".edits", ch, out);
+	out << std::endl << std::endl;
+	// end work with file & delete array
+	delete[] arrayOfCells;
 }
 
-void PrintDistances(Cell * arr, int rSize, int cSize)
+void RunBatch(int count, char ch, int workers, std::ostream & out)
 {
-	std::cout << std::endl << "Distances";
-	for (int i = 0; i < rSize * cSize; ++i)
+	std::vector<std::string> results(count);
+	std::vector<std::exception_ptr> errors(count);
+	std::vector<char> done(count, false);
+	std::mutex lock;
+	std::condition_variable ready;
+	std::atomic<int> next(0);
+	workers = std::max(1, std::min(workers, count));
+	const int threadsPerFile = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / workers);
+
+	std::vector<std::thread> pool;
+	for (int t = 0; t < workers; ++t)
 	{
-		if (i % cSize == 0) { std::cout << std::endl; }
-		if (arr[i].value == true)
+		pool.emplace_back([&]()
 		{
-			if (arr[i].distance < 0) { std::cout << "0 "; }
-			else { std::cout << arr[i].distance % 10 << " "; }
-		}
-		else { std::cout << "# "; }
+			for (int i = next++; i < count; i = next++)
+			{
+				std::ostringstream buffer;
+				std::exception_ptr error;
+				try { SolveFile(i, ch, threadsPerFile, buffer); }
+				catch (...) { error = std::current_exception(); }
+				std::lock_guard<std::mutex> guard(lock);
+				results[i] = buffer.str();
+				errors[i] = error;
+				done[i] = true;
+				ready.notify_all();
+			}
+		});
 	}
-}
 
-void PrintMap(Cell * arr, int rSize, int cSize, char ch)
-{
-	std::cout << std::endl << "Map:";
-	for (int j = 0; j < rSize * cSize; ++j)
+	// emit in file order as soon as the next file is finished
+	std::exception_ptr error;
+	for (int i = 0; i < count && !error; ++i)
 	{
-		if (j % cSize == 0) { std::cout << std::endl; }
-		std::cout << (arr[j].value == true ? ch : '#') << " ";
+		std::unique_lock<std::mutex> guard(lock);
+		ready.wait(guard, [&]() { return done[i] != 0; });
+		std::string text;
+		text.swap(results[i]);
+		error = errors[i];
+		guard.unlock();
+		out << text << std::flush;
 	}
+	next = count; // stop handing out files after a failure
+	for (auto & worker : pool) { worker.join(); }
+	if (error) { std::rethrow_exception(error); }
 }
 
-void SetPathLength(Cell * arr, int i, int invokeLimit)
+int RunOutOfCore(const std::string & mapFileName, char ch, int tileSize, int cacheTiles)
 {
-	int resultCounter = 0;
-	bool isFinished = false;
-	std::vector<Cell *> tmpV;
-	Go(arr, &arr[i], tmpV, 0, isFinished, 0, invokeLimit, RLIMIT, &resultCounter);
+	TiledBfs bfs(tileSize, cacheTiles);
+	if (!bfs.Import(mapFileName, mapFileName + ".tiles", ch))
+	{
+		std::cout << "Can't open " << mapFileName << std::endl;
+		return 1;
+	}
+	long long imported = bfs.BytesWritten();
+	int maxDistance = 0;
+	long long reached = bfs.Run(0, &maxDistance);
+	std::cout << "FILE: " << mapFileName << " (" << bfs.Rows() << " x " << bfs.Columns() << ")" << std::endl
+		<< "Reached cells: " << reached << std::endl
+		<< "Longest distance from top-left: " << maxDistance << std::endl
+		<< "Distance to bottom-right: " << bfs.Distance(bfs.Rows() * bfs.Columns() - 1) << std::endl
+		<< "Tile file written during import: " << imported / (1024 * 1024) << " MB" << std::endl
+		<< "Tile I/O during BFS: " << bfs.BytesRead() / (1024 * 1024) << " MB read, "
+		<< (bfs.BytesWritten() - imported) / (1024 * 1024) << " MB written" << std::endl
+		<< "Peak memory: " << TiledBfs::PeakMemory() / (1024 * 1024) << " MB" << std::endl;
+	return 0;
 }
 
-void SetConnections(Cell * arr, int rSize, int cSize)
+void PrintDistances(Cell * arr, int rSize, int cSize, std::ostream & out)
 {
-	for (int i = 0; i < (rSize * cSize); ++i)
+	out << std::endl << "Distances";
+	for (int i = 0; i < rSize * cSize; ++i)
 	{
+		if (i % cSize == 0) { out << std::endl; }
 		if (arr[i].value == true)
 		{
-			if (i == 0) // top-left corner
-			{ CreateConnection(arr, i, false, true, false, true, NULL, cSize, NULL, 1); }
-			else if (i == cSize - 1) // top-right corner
-			{ CreateConnection(arr, i, false, true, true, false, NULL, i + cSize, i - 1, NULL); }
-			else if (i == cSize * (rSize - 1)) // bottom-left corner
-			{ CreateConnection(arr, i, true, false, false, true, i - cSize, NULL, NULL, i + 1); }
-			else if (i == rSize * cSize - 1) // bottom-right corner
-			{ CreateConnection(arr, i, true, false, true, false, i - cSize, NULL, i - 1, NULL); }
-			else if (i > 0 && i < cSize - 1) // top (except left & right corners)
-			{ CreateConnection(arr, i, false, true, true, true, NULL, i + cSize, i - 1, i + 1); }
-			else if (i > cSize * (rSize - 1) && i < rSize * cSize - 1) // bottom (except left & right corners)
-			{ CreateConnection(arr, i, true, false, true, true, i - cSize, NULL, i - 1, i + 1); }
-			else if (i > 0 && i < cSize * (rSize - 1) && i % cSize == 0) // left (except top & bottom corners)
-			{ CreateConnection(arr, i, true, true, false, true, i - cSize, i + cSize, NULL, i + 1); }
-			else if (i >(cSize - 1) && i < (cSize * rSize - 1) && ((i + 1) % cSize) == 0) // right (except top & bottom corners)
-			{ CreateConnection(arr, i, true, true, true, false, i - cSize, i + cSize, i - 1, NULL); }
-			else
-			{ CreateConnection(arr, i, true, true, true, true, i - cSize, i + cSize, i - 1, i + 1); }
+			if (arr[i].distance < 0) { out << "0 "; }
+			else { out << arr[i].distance % 10 << " "; }
 		}
+		else { out << "# "; }
 	}
 }
 
-std::string LoadContentString(std::fstream * file, int cSize)
+void PrintHpaPath(Cell * arr, int rSize, int cSize, const std::string & cacheName, int threads, std::ostream & out)
 {
-	std::string tmp, result;
-	while (!file->eof())
+	HpaGraph graph;
+	// a map without cells has no path and nothing worth caching
+	if (rSize * cSize > 0 && (!graph.Load(cacheName, rSize, cSize, HPA_CLUSTER_SIZE) || !graph.Matches(arr, rSize, cSize)))
 	{
-		getline(*file, tmp);
-		if (tmp.length() > cSize) { throw new std::exception("Array is to small for provided data."); }
-		result += tmp;
+		graph.Build(arr, rSize, cSize, HPA_CLUSTER_SIZE, threads);
+		graph.Save(cacheName);
 	}
-	return result;
+	out << std::endl << "HPA* path length (top-left -> bottom-right): ";
+	int length = graph.FindPath(0, rSize * cSize - 1, NULL);
+	if (length < 0) { out << "no path"; }
+	else { out << length; }
 }
 
-std::string ContentConverter(std::fstream * file, int cSize, char ch)
+void ApplyWallEdits(Cell * arr, int rSize, int cSize, const std::string & editsName, char ch, std::ostream & out)
 {
-	std::string result = LoadContentString(file, cSize);
-	for (int j = 0; j < result.length(); ++j)
+	std::fstream edits(editsName, std::ios::in);
+	if (!edits.good()) { return; }
+	DistanceField field;
+	field.Build(arr, rSize, cSize, 0);
+	int row, column;
+	while (edits >> row >> column)
 	{
-		if (result.at(j) == ch) { result.at(j) = '1'; }
-		else { result.at(j) = '0'; }
+		if (row < 0 || row >= rSize || column < 0 || column >= cSize) { continue; }
+		int repaired = field.ToggleWall(row * cSize + column);
+		field.Apply(arr);
+		out << std::endl << std::endl << "Toggled wall at " << row << " " << column
+			<< " (" << repaired << " cells repaired)";
+		PrintMap(arr, rSize, cSize, ch, out);
+		PrintDistances(arr, rSize, cSize, out);
 	}
-	return result;
 }
 
-void InitialValueAndDistance(Cell * arr, int rSize, int cSize)
+void PrintMap(Cell * arr, int rSize, int cSize, char ch, std::ostream & out)
 {
+	out << std::endl << "Map:";
 	for (int j = 0; j < rSize * cSize; ++j)
 	{
-		arr->value = NULL;
-		arr->distance = 0;
-	}
-}
-
-void SetupArrOfStructs(Cell * arr, int rSize, int cSize, int * wallCount, std::fstream * file, char ch)
-{
-	InitialValueAndDistance(arr, rSize, cSize);
-	std::string content = ContentConverter(file, cSize, ch);;
-	for (int j = 0; j < (rSize * cSize); ++j)
-	{
-		if (content.at(j) == '1') { arr[j].value = true; }
-		else
-		{
-			arr[j].value = false;
-			++*wallCount;
-		}
+		if (j % cSize == 0) { out << std::endl; }
+		out << (arr[j].value == true ? ch : '#') << " ";
 	}
 }
-
-void GetMatrixSizes(int * rSize, int * cSize, std::fstream * file)
-{
-	std::string tmp;
-	std::getline(*file, tmp);
-	*rSize = atoi(tmp.c_str());
-	getline(*file, tmp);
-	*cSize = atoi(tmp.c_str());
-}
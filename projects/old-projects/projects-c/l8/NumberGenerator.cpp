@@ -0,0 +1,69 @@
+#include "NumberGenerator.h"
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "NumberStats.h"
+#include "Parallel.h"
+#define WRITE_BUFFER (1 << 20)
+
+static unsigned long long SplitMix64(unsigned long long * state)
+{
+	unsigned long long x = (*state += 0x9E3779B97F4A7C15ULL);
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// 0..range - 1; a multiply instead of a division while the range fits in 32 bits
+static long long Below(unsigned long long * state, unsigned long long range)
+{
+	unsigned long long x = SplitMix64(state);
+	return static_cast<long long>(range <= 0xFFFFFFFFULL ? ((x >> 32) * range) >> 32 : x % range);
+}
+
+static bool WriteFile(const std::string & fileName, long long amount, long long range, unsigned long long state)
+{
+	std::fstream file;
+	file.rdbuf()->pubsetbuf(NULL, 0);
+	file.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.good()) { return false; }
+	bool raw = NumberStats::IsRaw(fileName);
+	std::vector<char> buffer(WRITE_BUFFER + 32);
+	char * out = buffer.data(), * full = buffer.data() + WRITE_BUFFER;
+	for (long long i = 0; i < amount; ++i)
+	{
+		long long value = Below(&state, range);
+		if (raw)
+		{
+			memcpy(out, &value, sizeof(value));
+			out += sizeof(value);
+		}
+		else
+		{
+			if (i > 0) { *out++ = '\n'; }
+			if (value < 10) { *out++ = static_cast<char>('0' + value); }
+			else { out = std::to_chars(out, out + 20, value).ptr; }
+		}
+		if (out >= full)
+		{
+			file.write(buffer.data(), out - buffer.data());
+			out = buffer.data();
+		}
+	}
+	file.write(buffer.data(), out - buffer.data());
+	file.close();
+	return !file.fail();
+}
+
+bool NumberGenerator::Write(const std::string * files, int size, long long amount, long long range, unsigned long long seed, int threads)
+{
+	std::atomic<bool> good(true);
+	ParallelFor(size, threads, [&](size_t i)
+	{
+		unsigned long long state = seed ^ (0xD1B54A32D192ED03ULL * (i + 1));
+		if (!WriteFile(files[i], amount, range, state)) { good = false; }
+	});
+	return good;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+//
+// Writes files of random numbers for the counter: text, one number per line without a line break after the
+// last, or raw 64-bit values when the file name ends in .bin (see NumberStats::IsRaw). Values come from
+// splitmix64 seeded per file and are formatted into a WRITE_BUFFER buffer that goes to the file with one
+// write, the stream itself unbuffered; the files are spread over the threads.
+//
+
+class NumberGenerator
+{
+public:
+	// amount values 0..range - 1 in each file; false when one of the files can't be written
+	static bool Write(const std::string * files, int size, long long amount, long long range, unsigned long long seed, int threads);
+};
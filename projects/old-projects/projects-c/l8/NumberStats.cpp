@@ -0,0 +1,276 @@
+#include "NumberStats.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include "MappedFile.h"
+#include "Parallel.h"
+#define CHUNK_SIZE (8 << 20) // bytes scanned by one task, a multiple of 8
+#define MAX_OPEN_FILES 256
+#define LANES 4 // interleaved histograms in a scan
+#define SMALL_VALUES 16 // values counted in the interleaved tables
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STATS_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// one chunk of a file
+struct Task
+{
+	int file;
+	size_t chunk;
+};
+
+NumberStats::NumberStats() : lines(0), first(0), last(0), firstRun(0), lastRun(0) {}
+
+static unsigned FirstBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// 0..9 for a digit, more for anything else
+static unsigned Digit(char c) { return static_cast<unsigned>(static_cast<unsigned char>(c)) - '0'; }
+
+// Value of the line [p, end) as atoi reads it, the digits that don't fit in 64 bits saturated.
+static long long ParseValue(const char * p, const char * end)
+{
+	while (p < end && (*p == ' ' || *p == '\t')) { ++p; }
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+')) { ++p; }
+	unsigned long long value = 0, limit = negative ? 0ULL - LLONG_MIN : LLONG_MAX;
+	for (; p < end && Digit(*p) < 10; ++p)
+	{
+		value = value > (limit - Digit(*p)) / 10 ? limit : value * 10 + Digit(*p);
+	}
+	return negative ? static_cast<long long>(0 - value) : static_cast<long long>(value);
+}
+
+NumberStats NumberStats::Scan(const char * begin, const char * end, bool raw, NumberStats * totals)
+{
+	NumberStats stats;
+	// the small values are counted round robin in LANES tables, so the same value on consecutive lines doesn't
+	// wait for its own counter to be stored
+	long long counts[LANES][SMALL_VALUES] = {}, longests[LANES][SMALL_VALUES] = {};
+	long long lines = 0, run = 0, firstRun = 0, previous = 0, runFloor = totals->RunFloor();
+	bool open = true; // still in the first run
+	auto add = [&](long long value)
+	{
+		bool same = value == previous && lines > 0;
+		// a run that is over; the first one may go on in the chunk before
+		if (!same && !open && run > runFloor)
+		{
+			totals->AddRun(previous, run);
+			runFloor = totals->RunFloor();
+		}
+		run = same ? run + 1 : 1;
+		previous = value;
+		if (lines == 0) { stats.first = value; }
+		open = open && (same || lines == 0);
+		firstRun += open;
+		unsigned lane = static_cast<unsigned>(lines++) % LANES;
+		if (static_cast<unsigned long long>(value) < SMALL_VALUES)
+		{
+			++counts[lane][value];
+			longests[lane][value] = std::max(longests[lane][value], run);
+		}
+		else { totals->values.Add(value, 1, run); }
+	};
+	const char * lineStart = begin;
+	auto line = [&](const char * lineEnd)
+	{
+		const char * p = lineStart;
+		lineStart = lineEnd + 1;
+		if (lineEnd > p && lineEnd[-1] == '\r') { --lineEnd; }
+		unsigned first = Digit(p[0]);
+		if (lineEnd - p == 1 && first < 10) { add(first); }
+		else if (lineEnd - p == 2 && first < 10 && Digit(p[1]) < 10) { add(first * 10 + Digit(p[1])); }
+		else if (lineEnd > p) { add(ParseValue(p, lineEnd)); }
+	};
+	if (raw)
+	{
+		for (const char * p = begin; end - p >= 8; p += 8)
+		{
+			long long value;
+			memcpy(&value, p, sizeof(value));
+			add(value);
+		}
+		lineStart = end;
+	}
+	const char * p = raw ? end : begin;
+#ifdef STATS_SSE2
+	const __m128i newlines = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16)
+	{
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), newlines));
+		for (; mask != 0; mask &= mask - 1) { line(p + FirstBit(mask)); }
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		if (*p == '\n') { line(p); }
+	}
+	if (lineStart < end) { line(end); }
+	for (int j = 0; j < SMALL_VALUES; ++j)
+	{
+		long long count = 0, longest = 0;
+		for (int lane = 0; lane < LANES; ++lane)
+		{
+			count += counts[lane][j];
+			longest = std::max(longest, longests[lane][j]);
+		}
+		if (count > 0) { totals->values.Add(j, count, longest); }
+	}
+	stats.firstRun = firstRun;
+	stats.last = previous;
+	stats.lastRun = run;
+	stats.lines = lines;
+	return stats;
+}
+
+void NumberStats::Merge(const NumberStats & other)
+{
+	values.Merge(other.values);
+	for (const Run & run : other.runs) { AddRun(run.value, run.length); }
+}
+
+void NumberStats::Append(const NumberStats & next)
+{
+	Merge(next);
+	if (next.lines == 0) { return; }
+	if (lines == 0)
+	{
+		lines = next.lines;
+		first = next.first;
+		last = next.last;
+		firstRun = next.firstRun;
+		lastRun = next.lastRun;
+		return;
+	}
+	// a run covering all the lines of one side goes on at its other end
+	bool whole = firstRun == lines, nextWhole = next.firstRun == next.lines;
+	if (last == next.first)
+	{
+		long long joined = lastRun + next.firstRun;
+		values.SetLongest(last, joined);
+		if (!whole && !nextWhole) { AddRun(last, joined); }
+		if (whole) { firstRun = joined; }
+		lastRun = nextWhole ? joined : next.lastRun;
+	}
+	else
+	{
+		if (!whole) { AddRun(last, lastRun); }
+		if (!nextWhole) { AddRun(next.first, next.firstRun); }
+		lastRun = next.lastRun;
+	}
+	last = next.last;
+	lines += next.lines;
+}
+
+void NumberStats::Close()
+{
+	if (lines == 0) { return; }
+	AddRun(first, firstRun);
+	if (firstRun != lines) { AddRun(last, lastRun); }
+}
+
+static bool ShorterRun(const Run & a, const Run & b) { return a.length > b.length; }
+
+void NumberStats::AddRun(long long value, long long length)
+{
+	if (runs.size() == TOP_RUNS)
+	{
+		if (length <= runs.front().length) { return; }
+		std::pop_heap(runs.begin(), runs.end(), ShorterRun);
+		runs.pop_back();
+	}
+	runs.push_back({ value, length });
+	std::push_heap(runs.begin(), runs.end(), ShorterRun);
+}
+
+long long NumberStats::RunFloor() const { return runs.size() == TOP_RUNS ? runs.front().length : 0; }
+
+std::vector<Run> NumberStats::LongestRuns() const
+{
+	std::vector<Run> sorted = runs;
+	std::sort_heap(sorted.begin(), sorted.end(), ShorterRun);
+	return sorted;
+}
+
+bool NumberStats::IsRaw(const std::string & fileName)
+{
+	return fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".bin") == 0;
+}
+
+// Where the chunks of [data, end) start, each behind the first line break at or after its offset, or at its
+// offset in a raw file; the last entry is end.
+static void ChunkStarts(const char * data, const char * end, bool raw, std::vector<const char *> * starts)
+{
+	size_t chunks = (end - data + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	starts->assign(chunks + 1, end);
+	for (size_t k = 0; k < chunks; ++k)
+	{
+		const char * start = data + k * CHUNK_SIZE;
+		if (!raw && k > 0 && start[-1] != '\n')
+		{
+			const char * newline = static_cast<const char *>(memchr(start, '\n', end - start));
+			start = newline != NULL ? newline + 1 : end;
+		}
+		(*starts)[k] = start;
+	}
+}
+
+bool NumberStats::Analyze(const std::string * files, int size, int threads, const long long * from, const long long * to, NumberStats * stats)
+{
+	threads = std::max(1, threads);
+	// files are mapped a batch at a time, so their number is not limited by open handles
+	for (int batch = 0; batch < size; batch += MAX_OPEN_FILES)
+	{
+		int count = std::min(size - batch, MAX_OPEN_FILES);
+		std::vector<MappedFile> mapped(count);
+		std::vector<std::vector<const char *>> starts(count);
+		std::vector<Task> tasks;
+		for (int i = 0; i < count; ++i)
+		{
+			int file = batch + i;
+			if (!mapped[i].Open(files[file])) { return false; }
+			bool raw = IsRaw(files[file]);
+			long long length = static_cast<long long>(raw ? mapped[i].Size() / 8 * 8 : mapped[i].Size());
+			long long end = to != NULL ? std::min(to[file], length) : length, start = from != NULL ? std::min(from[file], end) : 0;
+			ChunkStarts(mapped[i].Data() + start, mapped[i].Data() + end, raw, &starts[i]);
+			for (size_t k = 0; k + 1 < starts[i].size(); ++k) { tasks.push_back({ i, k }); }
+		}
+		std::vector<NumberStats> edges(tasks.size());
+		std::vector<NumberStats> totals(static_cast<size_t>(threads) * count);
+		ParallelForWorkers(tasks.size(), threads, [&](size_t t, int worker)
+		{
+			const Task & task = tasks[t];
+			NumberStats & total = totals[static_cast<size_t>(worker) * count + task.file];
+			edges[t] = Scan(starts[task.file][task.chunk], starts[task.file][task.chunk + 1], IsRaw(files[batch + task.file]), &total);
+		});
+		// the counts first, so the runs joined at the chunk boundaries find their values
+		for (int i = 0; i < count; ++i)
+		{
+			stats[batch + i] = NumberStats();
+			for (int worker = 0; worker < threads; ++worker) { stats[batch + i].Merge(totals[static_cast<size_t>(worker) * count + i]); }
+		}
+		// the tasks of a file are in order, its chunks are appended so
+		for (size_t t = 0; t < tasks.size(); ++t) { stats[batch + tasks[t].file].Append(edges[t]); }
+	}
+	return true;
+}
+
+bool NumberStats::Analyze(const std::string * files, int size, int threads, NumberStats * stats)
+{
+	if (!Analyze(files, size, threads, NULL, NULL, stats)) { return false; }
+	for (int i = 0; i < size; ++i) { stats[i].Close(); }
+	return true;
+}
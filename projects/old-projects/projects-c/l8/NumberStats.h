@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ValueHistogram.h"
+#define TOP_RUNS 10 // longest runs kept for every file
+
+//
+// How often each 64-bit value occurs in a file, one per line, its longest run and the longest runs overall.
+// The files are mapped and split into chunks of whole lines, and the chunks of all of them go to one pool of
+// threads. Every thread adds its counts and runs into its own cache-line-aligned stats per file, merged when
+// the pool is done; besides that every chunk keeps only the value and length of its first and last run, so a
+// run crossing chunk boundaries is joined when the chunks are appended in order and the runs stay exact.
+// A scan finds the line breaks 16 bytes at a time with SSE2, reads one- and two-digit values directly and
+// counts values below SMALL_VALUES round robin into interleaved tables; the others go to the histogram,
+// which stays an array while their range is narrow. Lines are read the way atoi reads them, saturated to
+// 64 bits; empty lines are skipped. Raw files are read 8 bytes a value.
+//
+
+struct Run
+{
+	long long value, length;
+};
+
+struct alignas(64) NumberStats
+{
+	ValueHistogram values;
+	std::vector<Run> runs; // the TOP_RUNS longest runs that are over, a heap with the shortest on top
+	long long lines; // non-empty lines
+	long long first, last; // values of the first and last run
+	long long firstRun, lastRun;
+
+	NumberStats();
+	// adds the counts and the runs of the lines in [begin, end), which starts at a line, or of the raw values
+	// there, to totals; returns the runs at its ends, which may go on in the chunks around
+	static NumberStats Scan(const char * begin, const char * end, bool raw, NumberStats * totals);
+	// adds the counts and runs of other, lines anywhere else in the file
+	void Merge(const NumberStats & other);
+	// joins the runs at the ends with the ones of the lines that follow these
+	void Append(const NumberStats & next);
+	// ends the runs at both ends, when the whole file was appended
+	void Close();
+	void AddRun(long long value, long long length);
+	// length a run has to exceed to be kept
+	long long RunFloor() const;
+	// the longest first
+	std::vector<Run> LongestRuns() const;
+	// a .bin file holds raw 64-bit values in the byte order of the machine, a partial one at its end ignored
+	static bool IsRaw(const std::string & fileName);
+	// stats[i] for files[i]; false when one of the files can't be read
+	static bool Analyze(const std::string * files, int size, int threads, NumberStats * stats);
+	// stats[i] for the bytes from[i] .. to[i] of files[i], both at the start of a line or value, not closed so
+	// more may be appended; NULL for the whole files
+	static bool Analyze(const std::string * files, int size, int threads, const long long * from, const long long * to, NumberStats * stats);
+};
@@ -0,0 +1,146 @@
+#include "ResultCache.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Xxh64.h"
+#define CACHE_VERSION 1
+
+ResultCache::ResultCache(std::string fileName) : fileName(fileName) {}
+
+bool ResultCache::Load()
+{
+	entries.clear();
+	std::ifstream file(fileName, std::ios::in);
+	std::string magic;
+	int version, topRuns;
+	if (!(file >> magic >> version >> topRuns) || magic != "L8CACHE" || version != CACHE_VERSION || topRuns != TOP_RUNS) { return false; }
+	Entry entry;
+	long long floor;
+	size_t values, runs;
+	std::string name;
+	while (file >> entry.size >> entry.modified >> entry.hash >> entry.offset >> entry.stats.lines >> entry.stats.first >> entry.stats.last
+		>> entry.stats.firstRun >> entry.stats.lastRun >> floor >> values >> runs)
+	{
+		file.get();
+		std::getline(file, name);
+		std::vector<ValueHistogram::Entry> saved(values);
+		for (ValueHistogram::Entry & value : saved) { file >> value.value >> value.count >> value.longest >> value.error; }
+		entry.stats.runs.resize(runs);
+		for (Run & run : entry.stats.runs) { file >> run.value >> run.length; }
+		if (!file)
+		{
+			entries.clear();
+			return false;
+		}
+		entry.stats.values.Load(saved, floor);
+		entries[name] = entry;
+	}
+	if (!file.eof())
+	{
+		entries.clear();
+		return false;
+	}
+	return true;
+}
+
+bool ResultCache::Save() const
+{
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	file << "L8CACHE " << CACHE_VERSION << " " << TOP_RUNS << "\n";
+	for (const auto & cached : entries)
+	{
+		std::error_code error;
+		if (!std::filesystem::exists(cached.first, error)) { continue; }
+		const Entry & entry = cached.second;
+		std::vector<ValueHistogram::Entry> values = entry.stats.values.Top(SIZE_MAX);
+		file << entry.size << " " << entry.modified << " " << entry.hash << " " << entry.offset << " " << entry.stats.lines << " "
+			<< entry.stats.first << " " << entry.stats.last << " " << entry.stats.firstRun << " " << entry.stats.lastRun << " "
+			<< entry.stats.values.Floor() << " " << values.size() << " " << entry.stats.runs.size() << " " << cached.first << "\n";
+		for (const ValueHistogram::Entry & value : values) { file << value.value << " " << value.count << " " << value.longest << " " << value.error << "\n"; }
+		for (const Run & run : entry.stats.runs) { file << run.value << " " << run.length << "\n"; }
+	}
+	file.close();
+	return !file.fail();
+}
+
+// Reads what is needed of a file: entry gets its size, time, hash and where its whole lines end, tail the
+// bytes behind them, from where the cached stats stop when they hold for its start, -1 otherwise.
+bool ResultCache::Inspect(const std::string & name, Entry * entry, std::string * tail, long long * from) const
+{
+	std::error_code error;
+	auto modified = std::filesystem::last_write_time(name, error);
+	MappedFile file;
+	if (error || !file.Open(name)) { return false; }
+	const char * data = file.Data();
+	long long size = static_cast<long long>(file.Size()), hashed = 0;
+	entry->size = size;
+	entry->modified = static_cast<long long>(modified.time_since_epoch().count());
+	*from = -1;
+	Xxh64 hash;
+	bool unchanged = false;
+	auto old = entries.find(name);
+	if (old != entries.end() && size >= old->second.size)
+	{
+		const Entry & cached = old->second;
+		unchanged = size == cached.size && entry->modified == cached.modified;
+		if (!unchanged) { hash.Update(data, static_cast<size_t>(cached.size)); }
+		if (unchanged || hash.Digest() == cached.hash)
+		{
+			*from = cached.offset;
+			hashed = cached.size;
+		}
+		else { hash = Xxh64(); }
+		entry->hash = cached.hash;
+	}
+	if (!unchanged)
+	{
+		hash.Update(data + hashed, static_cast<size_t>(size - hashed));
+		entry->hash = hash.Digest();
+	}
+	long long start = std::max(*from, 0LL), offset = size;
+	if (NumberStats::IsRaw(name)) { offset = size / 8 * 8; }
+	else
+	{
+		while (offset > start && data[offset - 1] != '\n') { --offset; }
+	}
+	entry->offset = offset;
+	tail->assign(data + offset, data + size);
+	return true;
+}
+
+bool ResultCache::Analyze(const std::string * files, int size, int threads, NumberStats * stats)
+{
+	std::vector<Entry> fresh(size);
+	std::vector<std::string> tails(size);
+	std::vector<long long> from(size), to(size);
+	std::atomic<bool> good(true);
+	ParallelFor(size, threads, [&](size_t i)
+	{
+		if (!Inspect(files[i], &fresh[i], &tails[i], &from[i])) { good = false; }
+	});
+	if (!good) { return false; }
+	for (int i = 0; i < size; ++i)
+	{
+		if (from[i] >= 0) { fresh[i].stats = entries.at(files[i]).stats; }
+		else { from[i] = 0; }
+		to[i] = fresh[i].offset;
+	}
+	std::vector<NumberStats> counted(size);
+	if (!NumberStats::Analyze(files, size, threads, from.data(), to.data(), counted.data())) { return false; }
+	for (int i = 0; i < size; ++i)
+	{
+		fresh[i].stats.Append(counted[i]);
+		stats[i] = fresh[i].stats;
+		NumberStats tail;
+		NumberStats edges = NumberStats::Scan(tails[i].data(), tails[i].data() + tails[i].size(), NumberStats::IsRaw(files[i]), &tail);
+		stats[i].Merge(tail);
+		stats[i].Append(edges);
+		stats[i].Close();
+	}
+	for (int i = 0; i < size; ++i) { entries[files[i]] = fresh[i]; }
+	return true;
+}
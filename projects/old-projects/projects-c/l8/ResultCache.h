@@ -0,0 +1,37 @@
+#pragma once
+#include <map>
+#include <string>
+#include "NumberStats.h"
+
+//
+// Stats of the files counted before, kept in a text file between runs. A file is known by its name, size,
+// modification time and XXH64 of its content. With the same size and time it is taken as unchanged without
+// hashing it; otherwise its first size bytes are hashed again, and when they are what was counted the file
+// only grew, so counting goes on from where it stopped. Anything else is counted from the start.
+// Kept are the stats of the whole lines (or values) of a file, not closed, and where they end; a last line
+// without a line break is counted again every run, since appending may continue it.
+//
+
+class ResultCache
+{
+	struct Entry
+	{
+		long long size, modified, offset; // offset - where the whole lines end
+		unsigned long long hash;
+		NumberStats stats;
+	};
+
+	std::string fileName;
+	std::map<std::string, Entry> entries;
+
+	bool Inspect(const std::string & name, Entry * entry, std::string * tail, long long * from) const;
+
+public:
+	explicit ResultCache(std::string fileName);
+	// false when there is no cache or it is damaged, which leaves it empty
+	bool Load();
+	// keeps the files that still exist
+	bool Save() const;
+	// like NumberStats::Analyze, counting only what changed since the files were cached, and caching them
+	bool Analyze(const std::string * files, int size, int threads, NumberStats * stats);
+};
@@ -0,0 +1,209 @@
+#include "ValueHistogram.h"
+#include <algorithm>
+#define DENSE_START 64
+#define DENSE_LIMIT (1 << 14) // widest range of values kept in an array
+#define MAX_TRACKED (1 << 14) // values in the hash table before the least frequent are dropped
+
+static size_t Hash(long long value)
+{
+	unsigned long long x = static_cast<unsigned long long>(value);
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return static_cast<size_t>(x ^ (x >> 31));
+}
+
+// the power of two at least size
+static size_t Capacity(size_t size)
+{
+	size_t capacity = 1;
+	while (capacity < size) { capacity *= 2; }
+	return capacity;
+}
+
+ValueHistogram::ValueHistogram() : base(0), floor(0), used(0), hashed(false) {}
+
+// Hashed: the slot of value, a free one when it is not there.
+ValueHistogram::Entry * ValueHistogram::Find(long long value)
+{
+	size_t mask = entries.size() - 1;
+	for (size_t i = Hash(value) & mask;; i = (i + 1) & mask)
+	{
+		if (entries[i].count == 0 || entries[i].value == value) { return &entries[i]; }
+	}
+}
+
+const ValueHistogram::Entry * ValueHistogram::Find(long long value) const
+{
+	return const_cast<ValueHistogram *>(this)->Find(value);
+}
+
+// The entry of value when it is tracked, NULL otherwise.
+ValueHistogram::Entry * ValueHistogram::Taken(long long value)
+{
+	if (entries.empty()) { return NULL; }
+	if (!hashed)
+	{
+		unsigned long long i = static_cast<unsigned long long>(value) - static_cast<unsigned long long>(base);
+		return i < entries.size() && entries[i].count > 0 ? &entries[i] : NULL;
+	}
+	Entry * entry = Find(value);
+	return entry->count > 0 ? entry : NULL;
+}
+
+// Grows the array to cover value; false when the range would get wider than DENSE_LIMIT. Positions are
+// taken modulo 2^64, so a range may wrap around from the largest values to the smallest.
+bool ValueHistogram::Widen(long long value)
+{
+	unsigned long long start = static_cast<unsigned long long>(base), size = entries.size();
+	unsigned long long newStart = static_cast<unsigned long long>(value), newSize = DENSE_START;
+	if (size > 0)
+	{
+		unsigned long long above = static_cast<unsigned long long>(value) - (start + size - 1);
+		unsigned long long below = start - static_cast<unsigned long long>(value);
+		unsigned long long grow = std::min(above, below);
+		if (grow > DENSE_LIMIT - size) { return false; }
+		newSize = std::min<unsigned long long>(DENSE_LIMIT, std::max(size + grow, 2 * size));
+		newStart = above <= below ? start : start - (newSize - size);
+	}
+	std::vector<Entry> widened(newSize, Entry());
+	for (unsigned long long i = 0; i < newSize; ++i) { widened[i].value = static_cast<long long>(newStart + i); }
+	for (unsigned long long i = 0, offset = start - newStart; i < size; ++i) { widened[offset + i] = entries[i]; }
+	entries.swap(widened);
+	base = static_cast<long long>(newStart);
+	return true;
+}
+
+void ValueHistogram::Rehash(size_t capacity)
+{
+	std::vector<Entry> old;
+	old.swap(entries);
+	entries.assign(capacity, Entry());
+	used = 0;
+	hashed = true;
+	for (const Entry & entry : old)
+	{
+		if (entry.count == 0) { continue; }
+		*Find(entry.value) = entry;
+		++used;
+	}
+}
+
+// Keeps the MAX_TRACKED / 2 most frequent values.
+void ValueHistogram::Prune()
+{
+	std::vector<Entry> kept;
+	for (const Entry & entry : entries)
+	{
+		if (entry.count > 0) { kept.push_back(entry); }
+	}
+	size_t keep = MAX_TRACKED / 2;
+	std::nth_element(kept.begin(), kept.begin() + keep, kept.end(), [](const Entry & a, const Entry & b) { return a.count > b.count; });
+	floor = std::max(floor, kept[keep].count);
+	kept.resize(keep);
+	std::fill(entries.begin(), entries.end(), Entry());
+	used = 0;
+	for (const Entry & entry : kept)
+	{
+		*Find(entry.value) = entry;
+		++used;
+	}
+}
+
+void ValueHistogram::Add(long long value, long long count, long long longest, long long error)
+{
+	Entry * entry;
+	if (!hashed)
+	{
+		unsigned long long i = static_cast<unsigned long long>(value) - static_cast<unsigned long long>(base);
+		if (i < entries.size() || Widen(value))
+		{
+			entry = &entries[static_cast<unsigned long long>(value) - static_cast<unsigned long long>(base)];
+			if (entry->count == 0) { entry->count = entry->error = floor; }
+			entry->count += count;
+			entry->error += error;
+			entry->longest = std::max(entry->longest, longest);
+			return;
+		}
+		size_t capacity = DENSE_START;
+		for (const Entry & taken : entries) { capacity += taken.count > 0 ? 2 : 0; }
+		Rehash(Capacity(capacity));
+	}
+	entry = Find(value);
+	if (entry->count == 0)
+	{
+		if (used >= MAX_TRACKED)
+		{
+			Prune();
+			entry = Find(value);
+		}
+		else if (2 * (used + 1) > entries.size())
+		{
+			Rehash(2 * entries.size());
+			entry = Find(value);
+		}
+		entry->value = value;
+		entry->count = entry->error = floor;
+		entry->longest = 0;
+		++used;
+	}
+	entry->count += count;
+	entry->error += error;
+	entry->longest = std::max(entry->longest, longest);
+}
+
+void ValueHistogram::Add(long long value, long long count, long long longest) { Add(value, count, longest, 0); }
+
+void ValueHistogram::SetLongest(long long value, long long longest)
+{
+	Entry * entry = Taken(value);
+	if (entry != NULL) { entry->longest = std::max(entry->longest, longest); }
+}
+
+void ValueHistogram::Merge(const ValueHistogram & other)
+{
+	// a value the other one dropped may have occurred up to its floor times there
+	if (other.floor > 0)
+	{
+		for (Entry & entry : entries)
+		{
+			bool there = other.hashed ? other.Find(entry.value)->count > 0
+				: static_cast<unsigned long long>(entry.value) - static_cast<unsigned long long>(other.base) < other.entries.size()
+					&& other.entries[static_cast<unsigned long long>(entry.value) - static_cast<unsigned long long>(other.base)].count > 0;
+			if (entry.count > 0 && !there)
+			{
+				entry.count += other.floor;
+				entry.error += other.floor;
+			}
+		}
+	}
+	for (const Entry & entry : other.entries)
+	{
+		if (entry.count > 0) { Add(entry.value, entry.count, entry.longest, entry.error); }
+	}
+	floor += other.floor;
+}
+
+long long ValueHistogram::Floor() const { return floor; }
+
+std::vector<ValueHistogram::Entry> ValueHistogram::Top(size_t n) const
+{
+	std::vector<Entry> top;
+	for (const Entry & entry : entries)
+	{
+		if (entry.count > 0) { top.push_back(entry); }
+	}
+	n = std::min(n, top.size());
+	std::partial_sort(top.begin(), top.begin() + n, top.end(), [](const Entry & a, const Entry & b)
+	{
+		return a.count != b.count ? a.count > b.count : a.value < b.value;
+	});
+	top.resize(n);
+	return top;
+}
+
+void ValueHistogram::Load(const std::vector<Entry> & saved, long long floor)
+{
+	*this = ValueHistogram();
+	for (const Entry & entry : saved) { Add(entry.value, entry.count, entry.longest, entry.error); }
+	this->floor = floor;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//
+// Count and longest run of every 64-bit value seen, in bounded memory. While the values span at most
+// DENSE_LIMIT the entries are an array indexed by value - base, grown to cover new values; a wider range
+// switches to an open-addressing hash table with linear probing.
+// When more than MAX_TRACKED values are tracked, the least frequent half is dropped the way space-saving
+// does it: the largest dropped count becomes the floor, and a value seen again later starts from the floor
+// and keeps it as its error. A count is then an upper bound and count - error a lower one; a value missing
+// from the table occurred at most floor times.
+//
+
+class ValueHistogram
+{
+public:
+	struct Entry
+	{
+		long long value, count, longest, error;
+	};
+
+private:
+	std::vector<Entry> entries; // dense: value base + i at i; hashed: count 0 when the slot is free
+	long long base, floor;
+	size_t used; // hashed: taken slots
+	bool hashed;
+
+	Entry * Find(long long value);
+	const Entry * Find(long long value) const;
+	Entry * Taken(long long value);
+	bool Widen(long long value);
+	void Rehash(size_t capacity);
+	void Prune();
+	void Add(long long value, long long count, long long longest, long long error);
+
+public:
+	ValueHistogram();
+	// count more of value, in a run of longest so far
+	void Add(long long value, long long count, long long longest);
+	// raises the longest run of a value that is tracked
+	void SetLongest(long long value, long long longest);
+	void Merge(const ValueHistogram & other);
+	long long Floor() const;
+	// the n most frequent values, the most frequent first
+	std::vector<Entry> Top(size_t n) const;
+	// replaces the contents with entries taken from Top() and the floor
+	void Load(const std::vector<Entry> & saved, long long floor);
+};
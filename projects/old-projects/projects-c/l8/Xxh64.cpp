@@ -0,0 +1,95 @@
+#include "Xxh64.h"
+#include <cstring>
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+static unsigned long long Rotate(unsigned long long x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+static unsigned long long Read64(const unsigned char * p)
+{
+	unsigned long long x;
+	memcpy(&x, p, sizeof(x));
+	return x;
+}
+
+static unsigned long long Round(unsigned long long accumulator, unsigned long long input)
+{
+	return Rotate(accumulator + input * PRIME2, 31) * PRIME1;
+}
+
+static unsigned long long MergeRound(unsigned long long hash, unsigned long long accumulator)
+{
+	return (hash ^ Round(0, accumulator)) * PRIME1 + PRIME4;
+}
+
+Xxh64::Xxh64() : total(0), buffered(0)
+{
+	v[0] = PRIME1 + PRIME2;
+	v[1] = PRIME2;
+	v[2] = 0;
+	v[3] = 0 - PRIME1;
+}
+
+void Xxh64::Update(const void * data, size_t length)
+{
+	if (length == 0) { return; }
+	const unsigned char * p = static_cast<const unsigned char *>(data), * end = p + length;
+	total += length;
+	if (buffered + length < 32)
+	{
+		memcpy(buffer + buffered, p, length);
+		buffered += length;
+		return;
+	}
+	if (buffered > 0)
+	{
+		memcpy(buffer + buffered, p, 32 - buffered);
+		p += 32 - buffered;
+		for (int lane = 0; lane < 4; ++lane) { v[lane] = Round(v[lane], Read64(buffer + 8 * lane)); }
+		buffered = 0;
+	}
+	unsigned long long v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+	for (; end - p >= 32; p += 32)
+	{
+		v0 = Round(v0, Read64(p));
+		v1 = Round(v1, Read64(p + 8));
+		v2 = Round(v2, Read64(p + 16));
+		v3 = Round(v3, Read64(p + 24));
+	}
+	v[0] = v0;
+	v[1] = v1;
+	v[2] = v2;
+	v[3] = v3;
+	buffered = end - p;
+	memcpy(buffer, p, buffered);
+}
+
+unsigned long long Xxh64::Digest() const
+{
+	unsigned long long hash;
+	if (total >= 32)
+	{
+		hash = Rotate(v[0], 1) + Rotate(v[1], 7) + Rotate(v[2], 12) + Rotate(v[3], 18);
+		for (int lane = 0; lane < 4; ++lane) { hash = MergeRound(hash, v[lane]); }
+	}
+	else { hash = PRIME5; }
+	hash += total;
+	const unsigned char * p = buffer, * end = buffer + buffered;
+	for (; end - p >= 8; p += 8) { hash = Rotate(hash ^ Round(0, Read64(p)), 27) * PRIME1 + PRIME4; }
+	if (end - p >= 4)
+	{
+		unsigned int word;
+		memcpy(&word, p, sizeof(word));
+		hash = Rotate(hash ^ (word * PRIME1), 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	for (; p < end; ++p) { hash = Rotate(hash ^ (*p * PRIME5), 11) * PRIME1; }
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	return hash ^ (hash >> 32);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+//
+// XXH64 of data given in pieces, the same as hashing it at once (seed 0).
+//
+
+class Xxh64
+{
+	unsigned long long v[4], total;
+	unsigned char buffer[32];
+	size_t buffered;
+
+public:
+	Xxh64();
+	void Update(const void * data, size_t length);
+	// the hash of everything so far; more may be added after
+	unsigned long long Digest() const;
+};
@@ -2,113 +2,41 @@
 #include <fstream>
 #include <time.h>
 #include <string>
-#define NUMBERS_AMOUNT 11
-#define NUMBERS_AMOUNT_IN_FILE 100
-
-void NumberCounter(int size, int * result, std::string * files)
-{
-	std::string tmp;
-	std::fstream file;
-
-	for (auto i = 0; i < size * NUMBERS_AMOUNT; ++i)
-		result[i] = 0;
-
-	for (auto i = 0; i < size; ++i)
-	{
-		file.open(files[i], std::ios::in);
-
-		if (!file.good())
-			throw new std::exception("Error while opening file");
-
-		while (!file.eof())
-		{
-			std::getline(file, tmp);
-			for (auto j = 0; j < NUMBERS_AMOUNT; ++j)
-				if (atoi(tmp.c_str()) == j) result[i * NUMBERS_AMOUNT + j]++;
-		}
-
-		file.close();
-	}
-}
-
-void MaxResult(std::string * files, int * resultMax, int size)
+#include <algorithm>
+#include <thread>
+#include "NumberGenerator.h"
+#include "NumberStats.h"
+#include "ResultCache.h"
+#define NUMBERS_AMOUNT 11 // numbers written are 0..NUMBERS_AMOUNT - 1
+#define NUMBERS_AMOUNT_IN_FILE 100 // numbers written to each file by default
+#define TOP_VALUES 20 // most frequent values reported for every file
+#define RESULT_CACHE "Results.cache"
+
+// All files are scanned once, their chunks spread over a pool of threads; files counted before are taken
+// from RESULT_CACHE, appended ones only have the new lines counted.
+void NumberCounter(int size, NumberStats * stats, std::string * files)
 {
-	std::fstream file;
-	std::string tmp;
-	int arrayTmp[NUMBERS_AMOUNT_IN_FILE];
-
-	for (auto i = 0; i < size * NUMBERS_AMOUNT; ++i)
-		resultMax[i] = 0;
+	auto threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	ResultCache cache(RESULT_CACHE);
 
-	for (auto i = 0; i < size; ++i)
-	{
-		auto isFirst = true;
-		auto counter = 0;
-
-		file.open(files[i], std::ios::in);
-
-		for (auto j = 0; j < NUMBERS_AMOUNT_IN_FILE; ++j)
-		{
-			std::getline(file, tmp);
-			arrayTmp[j] = atoi(tmp.c_str());
-		}
-
-		for (auto j = 0; j < (NUMBERS_AMOUNT_IN_FILE - 1); ++j)
-		{
-			if (arrayTmp[j] == arrayTmp[j + 1])
-			{
-				if (isFirst)
-				{
-					counter = 2;
-					isFirst = false;
-				}
-				else counter++;
-			}
-			else
-			{
-				isFirst = true;
-
-				if (resultMax[i * NUMBERS_AMOUNT + arrayTmp[j]] == 0) resultMax[i * NUMBERS_AMOUNT + arrayTmp[j]] = 1;
-				else if (resultMax[i * NUMBERS_AMOUNT + arrayTmp[j]] < counter)
-				{
-					resultMax[i * NUMBERS_AMOUNT + arrayTmp[j]] = counter;
-					counter = 0;
-				}
-			}
-
-			if (arrayTmp[98] == arrayTmp[(NUMBERS_AMOUNT_IN_FILE - 1)] && resultMax[i * NUMBERS_AMOUNT + arrayTmp[(NUMBERS_AMOUNT_IN_FILE - 1)] < counter])
-				resultMax[i * NUMBERS_AMOUNT + arrayTmp[(NUMBERS_AMOUNT_IN_FILE - 1)]] = counter;
-
-			if (resultMax[i * NUMBERS_AMOUNT + arrayTmp[(NUMBERS_AMOUNT_IN_FILE - 1)]] == 0)
-				resultMax[i * NUMBERS_AMOUNT + arrayTmp[(NUMBERS_AMOUNT_IN_FILE - 1)]] = 1;
-		}
-
-		file.close();
-	}
+	cache.Load();
+	if (!cache.Analyze(files, size, threads, stats))
+		throw new std::exception("Error while opening file");
+	cache.Save();
 }
 
-void FilesWrite(std::string * files, const int size)
+void FilesWrite(std::string * files, const int size, const long long amount, const bool raw)
 {
-	srand(time(NULL));
-	std::fstream file;
+	auto threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
 
 	for (auto i = 0; i < size; ++i)
-	{
-		files[i] = "plik_" + std::to_string(i + 1) + ".txt";
-
-		file.open(files[i], std::ios::out);
-		if (!file.good())
-			throw new std::exception("B³¹d podczas otwierania pliku");
-
-		for (auto j = 0; j < (NUMBERS_AMOUNT_IN_FILE - 1); ++j)
-			file << (0 + (rand() % NUMBERS_AMOUNT)) << std::endl;
+		files[i] = "plik_" + std::to_string(i + 1) + (raw ? ".bin" : ".txt");
 
-		file << (0 + (rand() % NUMBERS_AMOUNT));
-		file.close();
-	}
+	if (!NumberGenerator::Write(files, size, amount, NUMBERS_AMOUNT, time(NULL), threads))
+		throw new std::exception("B³¹d podczas otwierania pliku");
 }
 
-void MakeResult(std::string * files, int *result, int * resultMax, const int size)
+void MakeResult(std::string * files, NumberStats * stats, const int size)
 {
 	std::fstream file;
 
@@ -119,29 +47,47 @@ void MakeResult(std::string * files, int *result, int * resultMax, const int siz
 	for (auto i = 0; i < size; ++i)
 	{
 		file << "Wyniki z " << files[i] << std::endl;
-		for (auto j = 0; j < NUMBERS_AMOUNT; j++)
+		for (auto & entry : stats[i].values.Top(TOP_VALUES))
+		{
+			file << "Dla " << entry.value << " - iloœæ wyst¹pieñ: " << entry.count;
+			if (entry.error > 0)
+				file << " (co najmniej " << entry.count - entry.error << ")";
+			file << " # max wyst¹pieñ z rzêdu: " << entry.longest << std::endl;
+		}
+
+		file << "Najd³u¿sze serie:";
+		auto separator = " ";
+		for (auto & run : stats[i].LongestRuns())
 		{
-			file << "Dla " << j << " - iloœæ wyst¹pieñ: " << result[i * NUMBERS_AMOUNT + j]
-				<< " # max wyst¹pieñ z rzêdu: " << resultMax[i * NUMBERS_AMOUNT + j]
-				<< std::endl;
+			file << separator << run.value << " - " << run.length << " razy";
+			separator = ", ";
 		}
 		file << std::endl;
+		file << std::endl;
 	}
 	file.close();
 }
 
-int main()
+// Usage: l8 [files = 10] [numbers in each file = NUMBERS_AMOUNT_IN_FILE] [bin - raw 64-bit values]
+//        l8 count file... - counts files that are already there
+int main(int argc, char ** argv)
 {
-	auto size = 10; // defines how many files should be created
+	auto counting = argc > 1 && std::string(argv[1]) == "count";
+	auto size = counting ? argc - 2 : argc > 1 ? atoi(argv[1]) : 10; // defines how many files should be created
+	auto amount = !counting && argc > 2 ? atoll(argv[2]) : NUMBERS_AMOUNT_IN_FILE;
+	auto raw = !counting && argc > 3 && std::string(argv[3]) == "bin";
 	auto * files = new std::string[size];
-	auto * result = new int[size * NUMBERS_AMOUNT];
-	auto * resultMax = new int[size * NUMBERS_AMOUNT];
-
-	FilesWrite(files, size);
-	NumberCounter(size, result, files);
-	MaxResult(files, resultMax, size);
-	MakeResult(files, result, resultMax, size);
-
-	delete[] files, result, resultMax;
+	auto * stats = new NumberStats[size];
+
+	if (counting)
+		for (auto i = 0; i < size; ++i)
+			files[i] = argv[i + 2];
+	else
+		FilesWrite(files, size, amount, raw);
+	NumberCounter(size, stats, files);
+	MakeResult(files, stats, size);
+
+	delete[] files;
+	delete[] stats;
 	return 0;
 }
@@ -0,0 +1,97 @@
+#include "AppendFile.h"
+#include <atomic>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<unsigned long long> totalWritten(0);
+
+#ifdef _WIN32
+
+AppendFile::AppendFile() : handle(INVALID_HANDLE_VALUE) {}
+
+bool AppendFile::Open(const std::string & fileName, bool truncate)
+{
+	Close();
+	handle = CreateFileA(fileName.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	return handle != INVALID_HANDLE_VALUE;
+}
+
+bool AppendFile::IsOpen() const { return handle != INVALID_HANDLE_VALUE; }
+
+bool AppendFile::Write(const char * data, size_t size)
+{
+	LARGE_INTEGER zero = {};
+	if (!SetFilePointerEx(handle, zero, NULL, FILE_END)) { return false; }
+	while (size > 0)
+	{
+		DWORD written = 0;
+		DWORD chunk = size > 0x40000000 ? 0x40000000 : static_cast<DWORD>(size);
+		if (!WriteFile(handle, data, chunk, &written, NULL)) { return false; }
+		totalWritten += written;
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+bool AppendFile::Sync() { return FlushFileBuffers(handle) != 0; }
+
+void AppendFile::Close()
+{
+	if (handle != INVALID_HANDLE_VALUE) { CloseHandle(handle); }
+	handle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+AppendFile::AppendFile() : fileDescriptor(-1) {}
+
+bool AppendFile::Open(const std::string & fileName, bool truncate)
+{
+	Close();
+	fileDescriptor = open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), 0644);
+	return fileDescriptor >= 0;
+}
+
+bool AppendFile::IsOpen() const { return fileDescriptor >= 0; }
+
+bool AppendFile::Write(const char * data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t written = write(fileDescriptor, data, size);
+		if (written < 0 && errno == EINTR) { continue; }
+		if (written < 0) { return false; }
+		totalWritten += written;
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+	return true;
+}
+
+bool AppendFile::Sync()
+{
+#ifdef __APPLE__
+	return fsync(fileDescriptor) == 0;
+#else
+	return fdatasync(fileDescriptor) == 0;
+#endif
+}
+
+void AppendFile::Close()
+{
+	if (fileDescriptor >= 0) { close(fileDescriptor); }
+	fileDescriptor = -1;
+}
+
+#endif
+
+AppendFile::~AppendFile() { Close(); }
+
+unsigned long long AppendFile::Written() { return totalWritten; }
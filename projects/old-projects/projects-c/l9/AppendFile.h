@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+//
+// Write-only file handle that appends and can force the data to disk (FlushFileBuffers on Windows,
+// fdatasync elsewhere). Streams cannot do the latter. Bytes written by all of them are counted.
+//
+
+class AppendFile
+{
+#ifdef _WIN32
+	void * handle;
+#else
+	int fileDescriptor;
+#endif
+
+	AppendFile(const AppendFile &);
+	AppendFile & operator=(const AppendFile &);
+
+public:
+	AppendFile();
+	~AppendFile();
+	bool Open(const std::string & fileName, bool truncate);
+	bool IsOpen() const;
+	bool Write(const char * data, size_t size);
+	bool Sync();
+	void Close();
+	// bytes written by all files so far
+	static unsigned long long Written();
+};
@@ -2,17 +2,18 @@
 #include <iostream>
 #include <conio.h>
 #include <stdlib.h>
+#include <thread>
+#define LIST_LIMIT 50
 
-CRUD::CRUD(std::string databaseName)
+CRUD::CRUD(std::string databaseName) : log(databaseName), cursor(databaseName), loaded(false), ordered(false)
 {
 	this->databaseName = databaseName;
 	ReadAll();
-	std::cout << "Size of Database = " << this->database.size() << std::endl << std::endl;
+	std::cout << "Size of Database = " << this->cursor.Rows() << std::endl << std::endl;
 }
 
 CRUD::~CRUD()
 {
-	Save();
 	system("cls");
 	std::cout << std::endl
 		<< "-----------------" << std::endl
@@ -22,27 +23,28 @@ CRUD::~CRUD()
 
 void CRUD::ReadAll()
 {
-	Contacts contact;
-	std::string tmp;
-	if (!this->database.empty()) { this->database.clear(); }
-	this->file.open(this->databaseName, std::ios::in);
-	if (!file.good()) throw new std::exception("Read() - can't open file.");
-	for (auto i = 0, checker = 1; !file.eof(); ++i, ++checker)
+	if (this->loaded)
 	{
-		if (checker % 4 == 1)
-		{
-			getline(file, tmp);
-			contact.id = atoi(tmp.c_str());
-		}
-		else if (checker % 4 == 2) { getline(file, contact.name); }
-		else if (checker % 4 == 3) { getline(file, contact.surname); }
-		else if (checker % 4 == 0)
-		{
-			getline(file, contact.phoneNumber);
-			this->database.push_back(contact);
-		}
+		this->log.Load(&this->database);
+		this->lookup.Rebuild(this->database);
+		this->fuzzy.Rebuild(this->database);
 	}
-	this->file.close();
+	else { this->log.Open(); }
+	if (!this->cursor.Open()) throw new std::exception("Read() - can't open file.");
+}
+
+void CRUD::LoadAll()
+{
+	if (this->loaded) { return; }
+	this->loaded = true;
+	ReadAll();
+}
+
+// The cursor reads edits back from the file, so they are written there first; the committer syncs them.
+void CRUD::Saved()
+{
+	this->log.Flush();
+	this->cursor.Refresh();
 }
 
 void CRUD::Create()
@@ -58,39 +60,56 @@ void CRUD::Create()
 	std::getline(std::cin, contact.surname);
 	std::cout << "Phone number: ";
 	std::getline(std::cin, contact.phoneNumber);
-	if (this->database.size() != 0)
+	contact.id = this->cursor.MaxId() + 1;
+	if (this->loaded)
 	{
-		contact.id = database.at(database.size() - 1).id + 1;
+		this->database.Push(contact);
+		this->lookup.Insert(this->database.Back());
+		this->fuzzy.Insert(this->database.Back());
 	}
-	else { contact.id = 1; }
-	this->database.push_back(contact);
+	this->log.AppendCreate(contact);
+	Saved();
 }
 
 void CRUD::Read(int index)
 {
+	if (this->cursor.Rows() == 0) { return; }
+	ContactView contact = this->cursor.Row(index);
 	std::cout << std::endl
-		<< "ID: " << this->database.at(index).id << std::endl
-		<< "Name: " << this->database.at(index).name << std::endl
-		<< "Surname: " << this->database.at(index).surname << std::endl
-		<< "Phone number: " << this->database.at(index).phoneNumber << std::endl;
+		<< "ID: " << contact.id << std::endl
+		<< "Name: " << contact.name << std::endl
+		<< "Surname: " << contact.surname << std::endl
+		<< "Phone number: " << contact.phoneNumber << std::endl;
 }
 
 void CRUD::Update(int index)
 {
+	if (this->cursor.Rows() == 0) { return; }
+	Contacts contact = this->cursor.Row(index).Materialize();
 	std::cout << std::endl
 		<< "----------" << std::endl
 		<< "| UPDATE |" << std::endl
 		<< "----------" << std::endl << std::endl
 		<< "Name: ";
-	std::getline(std::cin, this->database.at(index).name);
+	std::getline(std::cin, contact.name);
 	std::cout << "Surname: ";
-	std::getline(std::cin, this->database.at(index).surname);
+	std::getline(std::cin, contact.surname);
 	std::cout << "Phone number: ";
-	std::getline(std::cin, this->database.at(index).phoneNumber);
+	std::getline(std::cin, contact.phoneNumber);
+	if (this->loaded)
+	{
+		ContactView before = this->database.At(index);
+		this->database.Set(index, contact);
+		this->lookup.Update(before, this->database.At(index));
+		this->fuzzy.Update(before, this->database.At(index));
+	}
+	this->log.AppendUpdate(contact);
+	Saved();
 }
 
 void CRUD::Delete(int index)
 {
+	if (this->cursor.Rows() == 0) { return; }
 	char ch;
 	std::cout << std::endl
 		<< "----------" << std::endl
@@ -99,55 +118,220 @@ void CRUD::Delete(int index)
 		<< "Are you sure that you want delete that user from database? y / Anything else: " << std::endl;
 	if ((ch = getch()) == 'y')
 	{
-		this->database.at(index).name = "";
-		this->database.at(index).surname = "";
-		this->database.at(index).phoneNumber = "";
-		this->database.at(index).id = 0;
+		this->log.AppendDelete(this->cursor.Row(index).id);
+		if (this->loaded)
+		{
+			this->lookup.Erase(this->database, index);
+			this->fuzzy.Erase(this->database.At(index));
+			this->database.Erase(index);
+		}
+		Saved();
 		std::cout << "Person data deleted." << std::endl;
 	}
 	else { std::cout << "Action cancelled." << std::endl; }
 	_sleep(1500);
 }
 
-void CRUD::Save()
+void CRUD::Search(int & i)
 {
-	this->file.open(this->databaseName, std::ios::out);
-	if (!file.good()) throw new std::exception("Save() - can't open file.");
-	for (auto i = 0; i < database.size() ; ++i)
+	std::string surname, name;
+	std::cout << std::endl
+		<< "----------" << std::endl
+		<< "| SEARCH |" << std::endl
+		<< "----------" << std::endl << std::endl
+		<< "Surname or #id: ";
+	std::getline(std::cin, surname);
+	LoadAll();
+	int id;
+	if (!surname.empty() && surname[0] == '#') { id = atoi(surname.c_str() + 1); }
+	else
 	{
-		if (i != database.size()-1)
-		{
-			if (!database.at(i).name.empty() && !database.at(i).surname.empty()
-				&& !database.at(i).phoneNumber.empty())
-			{
-				this->file
-					<< database.at(i).id << std::endl
-					<< database.at(i).name << std::endl
-					<< database.at(i).surname << std::endl
-					<< database.at(i).phoneNumber << std::endl;
-			}
-		}
-		else
+		std::cout << "Name (may be empty): ";
+		std::getline(std::cin, name);
+		id = this->lookup.LowerBound(surname, name);
+	}
+	int found = this->lookup.Find(id);
+	if (found >= 0)
+	{
+		i = found;
+		this->ordered = surname.empty() || surname[0] != '#';
+	}
+	else
+	{
+		std::cout << "Nothing found." << std::endl;
+		_sleep(1500);
+	}
+}
+
+void CRUD::List()
+{
+	std::string from, to;
+	std::cout << std::endl
+		<< "--------" << std::endl
+		<< "| LIST |" << std::endl
+		<< "--------" << std::endl << std::endl
+		<< "Surnames from: ";
+	std::getline(std::cin, from);
+	std::cout << "To: ";
+	std::getline(std::cin, to);
+	for (const auto & contact : Range(from, to, LIST_LIMIT))
+	{
+		std::cout << contact.id << "\t" << contact.surname << " " << contact.name << "\t" << contact.phoneNumber << std::endl;
+	}
+	std::cout << std::endl << "Press any key." << std::endl;
+	getch();
+}
+
+void CRUD::FuzzySearch(int & i)
+{
+	std::string query;
+	std::cout << std::endl
+		<< "--------" << std::endl
+		<< "| FIND |" << std::endl
+		<< "--------" << std::endl << std::endl
+		<< "Part of name, surname or phone number: ";
+	std::getline(std::cin, query);
+	std::vector<ContactView> found = FuzzyFind(query, LIST_LIMIT);
+	for (size_t k = 0; k < found.size(); ++k)
+	{
+		std::cout << k + 1 << ". " << found[k].surname << " " << found[k].name << "\t" << found[k].phoneNumber << std::endl;
+	}
+	if (found.empty()) { std::cout << "Nothing found." << std::endl; }
+	else
+	{
+		std::cout << std::endl << "Number of the row to open (anything else - stay): ";
+		std::string choice;
+		std::getline(std::cin, choice);
+		int k = atoi(choice.c_str());
+		if (k >= 1 && k <= static_cast<int>(found.size())) { i = this->lookup.Find(found[k - 1].id); }
+		return;
+	}
+	_sleep(1500);
+}
+
+void CRUD::Import()
+{
+	std::string fileName;
+	std::cout << std::endl
+		<< "----------" << std::endl
+		<< "| IMPORT |" << std::endl
+		<< "----------" << std::endl << std::endl
+		<< "CSV or TSV file (name, surname, phone number): ";
+	std::getline(std::cin, fileName);
+	long long skipped = 0;
+	long long imported = ContactTransfer::Import(fileName, &this->log, std::thread::hardware_concurrency(), &skipped);
+	if (imported < 0) { std::cout << "Can't import that file." << std::endl; }
+	else
+	{
+		ReadAll();
+		std::cout << imported << " contacts imported, " << skipped << " lines skipped." << std::endl;
+	}
+	_sleep(1500);
+}
+
+void CRUD::Export()
+{
+	std::string fileName;
+	std::cout << std::endl
+		<< "----------" << std::endl
+		<< "| EXPORT |" << std::endl
+		<< "----------" << std::endl << std::endl
+		<< "File (.csv or .tsv): ";
+	std::getline(std::cin, fileName);
+	long long exported = ContactTransfer::Export(fileName, &this->cursor);
+	if (exported < 0) { std::cout << "Can't write that file." << std::endl; }
+	else { std::cout << exported << " contacts exported." << std::endl; }
+	_sleep(1500);
+}
+
+void CRUD::MergeSuggestions(int & i)
+{
+	std::cout << std::endl
+		<< "---------------------" << std::endl
+		<< "| MERGE SUGGESTIONS |" << std::endl
+		<< "---------------------" << std::endl << std::endl;
+	std::vector<std::vector<ContactView>> groups = Duplicates(LIST_LIMIT);
+	for (size_t k = 0; k < groups.size(); ++k)
+	{
+		std::cout << k + 1 << "." << std::endl;
+		for (const auto & contact : groups[k])
 		{
-			if (!database.at(i).name.empty() && !database.at(i).surname.empty()
-				&& !database.at(i).phoneNumber.empty())
-			{
-				this->file
-					<< database.at(i).id << std::endl
-					<< database.at(i).name << std::endl
-					<< database.at(i).surname << std::endl
-					<< database.at(i).phoneNumber;
-			}
+			std::cout << "   " << contact.surname << " " << contact.name << "\t" << contact.phoneNumber << "\tID: " << contact.id << std::endl;
 		}
 	}
-	this->file.close();
+	if (groups.empty()) { std::cout << "No duplicates found." << std::endl; }
+	else
+	{
+		std::cout << std::endl << "Number of the suggestion to open (anything else - stay): ";
+		std::string choice;
+		std::getline(std::cin, choice);
+		int k = atoi(choice.c_str());
+		if (k >= 1 && k <= static_cast<int>(groups.size())) { i = this->lookup.Find(groups[k - 1].front().id); }
+		return;
+	}
+	_sleep(1500);
+}
+
+// Moves to the neighbouring row, in file order or in surname order.
+void CRUD::Step(int & i, int step)
+{
+	if (this->cursor.Rows() == 0) { return; }
+	if (this->ordered)
+	{
+		i = this->lookup.Find(this->lookup.Neighbour(this->database.At(i), step));
+		return;
+	}
+	const int size = static_cast<int>(this->cursor.Rows());
+	i = ((i + step) % size + size) % size;
+}
+
+ContactView CRUD::FindById(int id)
+{
+	LoadAll();
+	int position = this->lookup.Find(id);
+	return position < 0 ? ContactView() : this->database.At(position);
+}
+
+ContactView CRUD::FindByName(const std::string & surname, const std::string & name)
+{
+	LoadAll();
+	ContactView contact = FindById(this->lookup.LowerBound(surname, name));
+	return contact.surname == surname && contact.name == name ? contact : ContactView();
+}
+
+std::vector<ContactView> CRUD::Range(const std::string & from, const std::string & to, size_t limit)
+{
+	LoadAll();
+	std::vector<ContactView> contacts;
+	for (int id : this->lookup.Range(from, to, limit)) { contacts.push_back(FindById(id)); }
+	return contacts;
+}
+
+std::vector<ContactView> CRUD::FuzzyFind(const std::string & query, size_t limit)
+{
+	LoadAll();
+	std::vector<ContactView> contacts;
+	for (int id : this->fuzzy.Search(query, limit)) { contacts.push_back(FindById(id)); }
+	return contacts;
+}
+
+std::vector<std::vector<ContactView>> CRUD::Duplicates(size_t limit)
+{
+	LoadAll();
+	std::vector<std::vector<ContactView>> groups;
+	for (const auto & group : ContactDedup::Find(this->database, std::thread::hardware_concurrency()))
+	{
+		if (groups.size() == limit) { break; }
+		groups.emplace_back();
+		for (size_t position : group) { groups.back().push_back(this->database.At(position)); }
+	}
+	return groups;
 }
 
 void CRUD::Refresh(int & i)
 {
-	if (i == this->database.size() - 1) --i;
-	Save();
-	ReadAll();
+	if (i >= static_cast<int>(this->cursor.Rows())) i = static_cast<int>(this->cursor.Rows()) - 1;
+	if (i < 0) i = 0;
 }
 
 void CRUD::Menu()
@@ -156,7 +340,9 @@ void CRUD::Menu()
 	auto i = 0;
 	while( ch == 'W' || ch == 'w' || ch == 'E' || ch == 'e' ||
 		ch == 'U' || ch == 'u' || ch == 'R' || ch == 'r' ||
-		ch == 'D' || ch == 'd' || ch == 'C' || ch == 'c' )
+		ch == 'D' || ch == 'd' || ch == 'C' || ch == 'c' ||
+		ch == 'S' || ch == 's' || ch == 'O' || ch == 'o' || ch == 'L' || ch == 'l' || ch == 'F' || ch == 'f' ||
+		ch == 'I' || ch == 'i' || ch == 'X' || ch == 'x' || ch == 'M' || ch == 'm' )
 	{
 		system("cls");
 		std::cout << std::endl
@@ -165,23 +351,28 @@ void CRUD::Menu()
 			<< "------------------------------------------------------" << std::endl
 			<< "| U - update | D - delete | R - refresh | C - create |" << std::endl
 			<< "------------------------------------------------------" << std::endl
-			<< "| Row " << i+1 << "/" << this->database.size() << std::endl
+			<< "| S - search | L - list by surname | O - order       |" << std::endl
+			<< "| F - find by part of name, surname or phone          |" << std::endl
+			<< "| I - import CSV / TSV | X - export CSV / TSV        |" << std::endl
+			<< "| M - merge suggestions for duplicate contacts       |" << std::endl
+			<< "------------------------------------------------------" << std::endl
+			<< "| Row " << i+1 << "/" << this->cursor.Rows()
+			<< (this->ordered ? " | order: surname" : " | order: file") << std::endl
 			<< "------------------------------------------------------" << std::endl << std::endl;
 		Read(i);
 		ch = getch();
-		if ( ch == 'W' || ch == 'w')
-		{
-			if (i > 0) { --i; }
-			else { i = this->database.size() - 1; }
-		}
-		else if ( ch == 'E' || ch == 'e')
-		{
-			if (i < this->database.size() - 1) { ++i; }
-			else { i = 0; }
-		}
+		if ( ch == 'W' || ch == 'w') { Step(i, -1); }
+		else if ( ch == 'E' || ch == 'e') { Step(i, 1); }
 		else if (ch == 'U' || ch == 'u') { Update(i); }
 		else if (ch == 'D' || ch == 'd') { Delete(i); Refresh(i); }
-		else if (ch == 'R' || ch == 'r') { Refresh(i); }
+		else if (ch == 'R' || ch == 'r') { ReadAll(); Refresh(i); }
 		else if (ch == 'C' || ch == 'c') { Create(); Refresh(i); }
+		else if (ch == 'S' || ch == 's') { Search(i); }
+		else if (ch == 'L' || ch == 'l') { List(); }
+		else if (ch == 'F' || ch == 'f') { FuzzySearch(i); }
+		else if (ch == 'O' || ch == 'o') { LoadAll(); this->ordered = !this->ordered; }
+		else if (ch == 'I' || ch == 'i') { Import(); Refresh(i); }
+		else if (ch == 'X' || ch == 'x') { Export(); }
+		else if (ch == 'M' || ch == 'm') { MergeSuggestions(i); }
 	}
 }
\ No newline at end of file
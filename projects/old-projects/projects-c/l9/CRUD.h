@@ -4,30 +4,51 @@
 #include <fstream>
 #include <memory>
 #include <iostream>
-
-struct Contacts
-{
-	std::string name, surname, phoneNumber;
-	int id;
-};
+#include "Contacts.h"
+#include "ContactCursor.h"
+#include "ContactDedup.h"
+#include "ContactLog.h"
+#include "ContactStore.h"
+#include "ContactTransfer.h"
+#include "ContactIndex.h"
+#include "TrigramIndex.h"
 
 class CRUD
 {
 	std::string databaseName;
-	std::fstream file;
-	std::vector<Contacts> database;
+	ContactLog log;
+	ContactCursor cursor;
+	// the contacts and their indexes are loaded on the first search, browsing only needs the cursor
+	ContactStore database;
+	ContactIndex lookup;
+	TrigramIndex fuzzy;
+	bool loaded, ordered;
 
 	void ReadAll();
-	void Save();
+	void LoadAll();
+	void Saved();
 	void Refresh(int &i);
 	void Create();
 	void Read(int index);
 	void Update(int index);
 	void Delete(int index);
+	void Search(int &i);
+	void List();
+	void FuzzySearch(int &i);
+	void Import();
+	void Export();
+	void MergeSuggestions(int &i);
+	void Step(int &i, int step);
 
 public:
 	explicit CRUD(std::string databaseName);
 	~CRUD();
 	void Menu();
+	ContactView FindById(int id); // id 0 when there is none
+	ContactView FindByName(const std::string & surname, const std::string & name);
+	std::vector<ContactView> Range(const std::string & from, const std::string & to, size_t limit);
+	std::vector<ContactView> FuzzyFind(const std::string & query, size_t limit);
+	// groups of contacts that look like one person entered more than once, at most limit of them
+	std::vector<std::vector<ContactView>> Duplicates(size_t limit);
 };
 
@@ -0,0 +1,268 @@
+#include "ContactCursor.h"
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include "ContactLog.h"
+#define OPEN_RETRIES 8 // the writer can replace the segment between reading the manifest and mapping it
+#define PAGE_ROWS 512
+#define CACHED_PAGES 64
+#define PREFETCH_PAGES 4 // index entries are requested this many pages ahead, records half as far
+
+ContactCursor::ContactCursor(std::string fileName) : fileName(fileName), generation(0), entries(NULL), trailer(),
+	readEnd(0), createdAscending(true), maxId(0), lastRow(0) {}
+
+// Forgets the database; a cursor that failed to open shows no rows.
+void ContactCursor::Reset()
+{
+	this->generation = 0;
+	this->segment.Close();
+	this->rows.Close();
+	this->entries = NULL;
+	this->trailer = RowTrailer();
+	this->rowOfId.clear();
+	this->tail.clear();
+	this->readEnd = 0;
+	this->deleted.clear();
+	this->updated.clear();
+	this->created.clear();
+	this->deletedCreated.clear();
+	this->createdAscending = true;
+	this->createdAt.clear();
+	this->maxId = 0;
+	this->pages.clear();
+	this->pageAt.clear();
+	this->lastRow = 0;
+}
+
+bool ContactCursor::Open()
+{
+	for (int attempt = 0; attempt < OPEN_RETRIES; ++attempt)
+	{
+		Reset();
+		unsigned long long current;
+		if (!ContactLog::ReadManifest(this->fileName, &current)) { return false; }
+		std::string segmentName = ContactLog::SegmentName(this->fileName, current);
+		if (!this->segment.Open(segmentName) || !this->rows.Open(ContactLog::RowsName(segmentName))
+			|| !ReadRowTrailer(this->rows.Data(), this->rows.Size(), &this->trailer) || this->trailer.baseLength > this->segment.Size())
+		{
+			continue;
+		}
+		this->generation = current;
+		this->entries = reinterpret_cast<const RowEntry *>(this->rows.Data());
+		this->maxId = this->trailer.rows > 0 ? this->trailer.maxId : 0;
+		this->readEnd = this->trailer.baseLength;
+		ReadRecords(this->segment.Data() + this->readEnd, this->segment.Data() + this->segment.Size());
+		return true;
+	}
+	Reset();
+	return false;
+}
+
+bool ContactCursor::Refresh()
+{
+	unsigned long long current;
+	if (!ContactLog::ReadManifest(this->fileName, &current)) { return false; }
+	if (current == this->generation)
+	{
+		std::ifstream in(ContactLog::SegmentName(this->fileName, current), std::ios::in | std::ios::binary | std::ios::ate);
+		if (in)
+		{
+			std::streamoff size = in.tellg();
+			if (size <= static_cast<std::streamoff>(this->readEnd)) { return false; }
+			std::string chunk(static_cast<size_t>(size - this->readEnd), '\0');
+			in.seekg(this->readEnd);
+			in.read(&chunk[0], chunk.size());
+			chunk.resize(static_cast<size_t>(in.gcount()));
+			this->tail.push_back(std::move(chunk)); // a deque never moves its strings, the views stay valid
+			bool changed = ReadRecords(this->tail.back().data(), this->tail.back().data() + this->tail.back().size());
+			if (!changed) { this->tail.pop_back(); }
+			return changed;
+		}
+		// the segment was replaced right after the manifest was read
+	}
+	return Open();
+}
+
+// Applies the complete records in [begin, end); a record still being written is read next time.
+bool ContactCursor::ReadRecords(const char * begin, const char * end)
+{
+	const char * p = begin;
+	char type;
+	ContactView contact;
+	for (const char * line = p; p < end && ContactLog::ReadRecord(&p, end, &type, &contact); line = p) { Apply(type, contact, line, p - line); }
+	this->readEnd += p - begin;
+	return p != begin;
+}
+
+void ContactCursor::Apply(char type, const ContactView & contact, const char * line, size_t length)
+{
+	if (type == 'C')
+	{
+		if (this->createdAscending && !this->created.empty() && contact.id <= this->created.back().id)
+		{
+			this->createdAscending = false;
+			for (size_t i = 0; i < this->created.size(); ++i) { this->createdAt[this->created[i].id] = i; }
+		}
+		if (!this->createdAscending) { this->createdAt[contact.id] = this->created.size(); }
+		Line entry = { line, static_cast<uint32_t>(length), contact.id };
+		this->created.push_back(entry);
+		this->maxId = std::max(this->maxId, contact.id);
+		return;
+	}
+	long long position = CreatedOf(contact.id);
+	long long row = position < 0 ? BaseRowOf(contact.id) : -1;
+	if (position < 0 && row < 0) { return; }
+	if (type == 'U') { this->updated[contact.id] = contact; }
+	else if (type == 'D')
+	{
+		std::vector<size_t> & skipped = position >= 0 ? this->deletedCreated : this->deleted;
+		size_t at = static_cast<size_t>(position >= 0 ? position : row);
+		skipped.insert(std::lower_bound(skipped.begin(), skipped.end(), at), at);
+		this->updated.erase(contact.id);
+	}
+}
+
+// Position of the contact among those created behind the base, -1 when it is not there or was deleted.
+long long ContactCursor::CreatedOf(int id) const
+{
+	size_t position;
+	if (this->createdAscending)
+	{
+		auto found = std::lower_bound(this->created.begin(), this->created.end(), id, [](const Line & line, int id) { return line.id < id; });
+		if (found == this->created.end() || found->id != id) { return -1; }
+		position = found - this->created.begin();
+	}
+	else
+	{
+		auto found = this->createdAt.find(id);
+		if (found == this->createdAt.end()) { return -1; }
+		position = found->second;
+	}
+	return std::binary_search(this->deletedCreated.begin(), this->deletedCreated.end(), position) ? -1 : static_cast<long long>(position);
+}
+
+// Base row of the contact, -1 when it has none or it was deleted.
+long long ContactCursor::BaseRowOf(int id)
+{
+	size_t row;
+	if (this->trailer.ascending)
+	{
+		const RowEntry * found = std::lower_bound(this->entries, this->entries + this->trailer.rows, id,
+			[](const RowEntry & entry, int id) { return entry.id < id; });
+		if (found == this->entries + this->trailer.rows || found->id != id) { return -1; }
+		row = found - this->entries;
+	}
+	else
+	{
+		if (this->rowOfId.empty())
+		{
+			for (size_t i = 0; i < this->trailer.rows; ++i) { this->rowOfId.emplace(this->entries[i].id, i); }
+		}
+		auto found = this->rowOfId.find(id);
+		if (found == this->rowOfId.end()) { return -1; }
+		row = found->second;
+	}
+	return std::binary_search(this->deleted.begin(), this->deleted.end(), row) ? -1 : static_cast<long long>(row);
+}
+
+// Position shown as the given row when the sorted positions in deleted are skipped: the first one with
+// row + 1 positions left up to it.
+static size_t Select(const std::vector<size_t> & deleted, size_t row)
+{
+	size_t low = row, high = row + deleted.size();
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		size_t left = middle + 1 - (std::upper_bound(deleted.begin(), deleted.end(), middle) - deleted.begin());
+		if (left >= row + 1) { high = middle; }
+		else { low = middle + 1; }
+	}
+	return low;
+}
+
+const ContactCursor::Page & ContactCursor::Fetch(size_t number)
+{
+	auto found = this->pageAt.find(number);
+	if (found != this->pageAt.end())
+	{
+		this->pages.splice(this->pages.begin(), this->pages, found->second);
+		return this->pages.front();
+	}
+	Page page;
+	page.number = number;
+	size_t first = number * PAGE_ROWS, last = std::min<size_t>(this->trailer.rows, first + PAGE_ROWS);
+	page.rows.reserve(last - first);
+	for (size_t row = first; row < last; ++row)
+	{
+		const RowEntry & entry = this->entries[row];
+		const char * p = this->segment.Data() + entry.offset;
+		char type;
+		ContactView contact;
+		if (entry.offset + entry.length > this->trailer.baseLength || !ContactLog::ReadRecord(&p, p + entry.length, &type, &contact) || type != 'C')
+		{
+			throw new std::exception("Row() - damaged segment.");
+		}
+		page.rows.push_back(contact);
+	}
+	this->pages.push_front(std::move(page));
+	this->pageAt[number] = this->pages.begin();
+	if (this->pages.size() > CACHED_PAGES)
+	{
+		this->pageAt.erase(this->pages.back().number);
+		this->pages.pop_back();
+	}
+	return this->pages.front();
+}
+
+void ContactCursor::Prefetch(size_t number, bool records) const
+{
+	size_t first = number * PAGE_ROWS, last = std::min<size_t>(this->trailer.rows, first + PAGE_ROWS);
+	if (first >= last || this->pageAt.count(number) != 0) { return; }
+	this->rows.Prefetch(first * sizeof(RowEntry), (last - first) * sizeof(RowEntry));
+	if (records)
+	{
+		uint64_t begin = this->entries[first].offset, end = this->entries[last - 1].offset + this->entries[last - 1].length;
+		this->segment.Prefetch(static_cast<size_t>(begin), static_cast<size_t>(end - begin));
+	}
+}
+
+size_t ContactCursor::Rows() const
+{
+	return this->trailer.rows - this->deleted.size() + this->created.size() - this->deletedCreated.size();
+}
+
+ContactView ContactCursor::Row(size_t row)
+{
+	size_t baseRows = this->trailer.rows - this->deleted.size();
+	if (row >= Rows()) { return ContactView(); }
+	ContactView contact;
+	if (row >= baseRows)
+	{
+		const Line & line = this->created[Select(this->deletedCreated, row - baseRows)];
+		const char * p = line.data;
+		char type;
+		ContactLog::ReadRecord(&p, p + line.length, &type, &contact);
+	}
+	else { contact = BaseContact(Select(this->deleted, row)); }
+	auto found = this->updated.find(contact.id);
+	return found == this->updated.end() ? contact : found->second;
+}
+
+ContactView ContactCursor::BaseContact(size_t base)
+{
+	size_t number = base / PAGE_ROWS;
+	if (number != this->lastRow / PAGE_ROWS)
+	{
+		// entering another page: keep reading ahead in the direction of browsing
+		long long direction = base > this->lastRow ? 1 : -1;
+		for (long long ahead = 1; ahead <= PREFETCH_PAGES; ++ahead)
+		{
+			long long next = static_cast<long long>(number) + direction * ahead;
+			if (next >= 0) { Prefetch(static_cast<size_t>(next), ahead <= PREFETCH_PAGES / 2); }
+		}
+	}
+	this->lastRow = base;
+	return Fetch(number).rows[base - number * PAGE_ROWS];
+}
+
+int ContactCursor::MaxId() const { return this->maxId; }
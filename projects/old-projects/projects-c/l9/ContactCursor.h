@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Contacts.h"
+#include "MappedFile.h"
+#include "RowIndex.h"
+
+//
+// Row-by-row view of the contact database that reads only the rows looked at, for browsing databases of any
+// size. Open() maps the current segment and its row index and reads the records appended behind the base.
+// Base rows are parsed a page at a time when first shown and the most recently used pages are kept; moving
+// through the rows asks the system to read the next pages in that direction ahead. Memory use is the cached
+// pages plus 16 bytes per record behind the base, whatever the size of the database.
+//
+// Records behind the base are laid over it the way replay would: updates replace base rows, deleted base
+// rows are skipped and created contacts follow the base, so row numbers are the positions Load() gives the
+// contacts in ContactStore. Views stay valid until the next Open().
+//
+
+class ContactCursor
+{
+	struct Page
+	{
+		size_t number;
+		std::vector<ContactView> rows;
+	};
+
+	// a record behind the base, parsed when it is shown
+	struct Line
+	{
+		const char * data;
+		uint32_t length;
+		int32_t id;
+	};
+
+	std::string fileName;
+	unsigned long long generation;
+	MappedFile segment, rows;
+	const RowEntry * entries;
+	RowTrailer trailer;
+	std::unordered_map<int, size_t> rowOfId; // only for a base whose ids do not ascend, built when needed
+
+	// records behind the base
+	std::deque<std::string> tail;
+	unsigned long long readEnd;
+	std::vector<size_t> deleted; // base rows, sorted
+	std::unordered_map<int, ContactView> updated; // by id
+	std::vector<Line> created;
+	std::vector<size_t> deletedCreated; // positions in created, sorted
+	bool createdAscending;
+	std::unordered_map<int, size_t> createdAt; // only once created ids stop ascending
+	int maxId;
+
+	std::list<Page> pages;
+	std::unordered_map<size_t, std::list<Page>::iterator> pageAt;
+	size_t lastRow;
+
+	long long BaseRowOf(int id);
+	long long CreatedOf(int id) const;
+	const Page & Fetch(size_t number);
+	ContactView BaseContact(size_t base);
+	void Prefetch(size_t number, bool records) const;
+	void Apply(char type, const ContactView & contact, const char * line, size_t length);
+	bool ReadRecords(const char * begin, const char * end);
+	void Reset();
+
+public:
+	explicit ContactCursor(std::string fileName);
+	bool Open();
+	// reads what was appended since; returns true when the database changed
+	bool Refresh();
+	size_t Rows() const;
+	ContactView Row(size_t row); // id 0 when there is none
+	int MaxId() const;
+};
@@ -0,0 +1,324 @@
+#include "ContactDedup.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include "Parallel.h"
+#define PHONE_DIGITS 9 // the number without the country code
+#define MIN_PHONE_DIGITS 6 // shorter numbers are too likely shared to block on
+#define BANDS 6
+#define BAND_ROWS 3
+#define KEYS (BANDS + 1) // the phone number, then the bands
+#define MAX_BUCKET 64
+#define BUCKET_WINDOW 8 // contacts of a bigger bucket are compared with this many behind them
+#define BLOCK 4096 // contacts per task while signing
+#define PARTS 256 // key ranges sorted and paired in parallel, by the top byte of the key
+#define SAME_PHONE_SIMILARITY 0.5
+#define NAME_SIMILARITY 0.75 // of every word: one wrong letter in four
+#define PHONE_SIMILARITY 0.85 // one wrong digit of nine
+
+struct KeyEntry
+{
+	uint64_t key;
+	uint32_t position, slot;
+
+	bool operator<(const KeyEntry & other) const { return key < other.key || (key == other.key && position < other.position); }
+};
+
+// a match of a contact without a phone number with one that has it
+struct WeakMatch
+{
+	uint32_t contact, other;
+	double similarity;
+
+	// by contact, best first
+	bool operator<(const WeakMatch & match) const
+	{
+		return contact < match.contact || (contact == match.contact && (similarity > match.similarity
+			|| (similarity == match.similarity && other < match.other)));
+	}
+};
+
+static uint64_t Mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// ASCII letter for a Polish letter in UTF-8, 0 for anything else.
+static char Fold(unsigned char first, unsigned char second)
+{
+	static const struct { unsigned char first, second; char letter; } letters[] =
+	{
+		{ 0xC4, 0x84, 'a' }, { 0xC4, 0x85, 'a' }, { 0xC4, 0x86, 'c' }, { 0xC4, 0x87, 'c' }, { 0xC4, 0x98, 'e' }, { 0xC4, 0x99, 'e' },
+		{ 0xC5, 0x81, 'l' }, { 0xC5, 0x82, 'l' }, { 0xC5, 0x83, 'n' }, { 0xC5, 0x84, 'n' }, { 0xC3, 0x93, 'o' }, { 0xC3, 0xB3, 'o' },
+		{ 0xC5, 0x9A, 's' }, { 0xC5, 0x9B, 's' }, { 0xC5, 0xB9, 'z' }, { 0xC5, 0xBA, 'z' }, { 0xC5, 0xBB, 'z' }, { 0xC5, 0xBC, 'z' }
+	};
+	for (const auto & letter : letters)
+	{
+		if (letter.first == first && letter.second == second) { return letter.letter; }
+	}
+	return 0;
+}
+
+// Lowercase words of name and surname with Polish letters folded.
+static std::vector<std::string> Words(const ContactView & contact)
+{
+	std::vector<std::string> words;
+	std::string word;
+	for (std::string_view text : { contact.name, contact.surname })
+	{
+		for (size_t i = 0; i <= text.size(); ++i)
+		{
+			unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+			char folded = i + 1 < text.size() ? Fold(c, static_cast<unsigned char>(text[i + 1])) : 0;
+			if (folded != 0)
+			{
+				word += folded;
+				++i;
+			}
+			else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) { word += static_cast<char>(c); }
+			else if (c >= 'A' && c <= 'Z') { word += static_cast<char>(c - 'A' + 'a'); }
+			else if (!word.empty())
+			{
+				words.push_back(word);
+				word.clear();
+			}
+		}
+	}
+	return words;
+}
+
+static std::string Join(const std::vector<std::string> & words)
+{
+	std::string text;
+	for (const auto & word : words) { text += (text.empty() ? "" : " ") + word; }
+	return text;
+}
+
+static std::string PhoneKey(std::string_view phone)
+{
+	std::string digits;
+	for (char c : phone)
+	{
+		if (c >= '0' && c <= '9') { digits += c; }
+	}
+	if (digits.size() > PHONE_DIGITS) { digits.erase(0, digits.size() - PHONE_DIGITS); }
+	return digits;
+}
+
+// 1 - edit distance / length of the longer text, or 0 as soon as it is certain to stay below minimum.
+static double Similarity(std::string_view a, std::string_view b, double minimum)
+{
+	size_t longer = std::max(a.size(), b.size());
+	if (longer == 0) { return 1; }
+	size_t allowed = static_cast<size_t>((1.0 - minimum) * longer + 1e-9);
+	if (std::max(a.size(), b.size()) - std::min(a.size(), b.size()) > allowed) { return 0; }
+	size_t small[64];
+	std::vector<size_t> large(b.size() < 64 ? 0 : b.size() + 1);
+	size_t * row = b.size() < 64 ? small : large.data();
+	std::iota(row, row + b.size() + 1, 0);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		size_t diagonal = row[0], least = row[0] = i + 1;
+		for (size_t j = 0; j < b.size(); ++j)
+		{
+			size_t above = row[j + 1];
+			row[j + 1] = std::min({ row[j] + 1, above + 1, diagonal + (a[i] != b[j]) });
+			diagonal = above;
+			least = std::min(least, row[j + 1]);
+		}
+		if (least > allowed) { return 0; } // distances never shrink further down
+	}
+	return row[b.size()] > allowed ? 0 : 1.0 - static_cast<double>(row[b.size()]) / longer;
+}
+
+// Similarity of the least alike pair of words when both have as many words, of the whole texts otherwise:
+// a long first name must not hide a different surname.
+static double NameSimilarity(std::string_view a, std::string_view b, double minimum)
+{
+	if (std::count(a.begin(), a.end(), ' ') != std::count(b.begin(), b.end(), ' ')) { return Similarity(a, b, minimum); }
+	double least = 1;
+	while (least > 0 && !a.empty())
+	{
+		size_t endA = std::min(a.find(' '), a.size()), endB = std::min(b.find(' '), b.size());
+		least = std::min(least, Similarity(a.substr(0, endA), b.substr(0, endB), minimum));
+		a.remove_prefix(std::min(endA + 1, a.size()));
+		b.remove_prefix(std::min(endB + 1, b.size()));
+	}
+	return least;
+}
+
+// What a contact is compared by: its name words as typed and sorted (swapped name and surname look the
+// same, a typo in a first letter moves a word), its phone number.
+struct Normalized
+{
+	std::string name, sorted, phone;
+};
+
+// Similarity of a and b when they look like one contact, 0 when not. Weak when only one of them has a
+// phone number, such a match is trusted only when it is the best the contact has.
+static double Duplicates(const Normalized & a, const Normalized & b, bool * weak)
+{
+	*weak = a.phone.empty() != b.phone.empty();
+	bool samePhone = !a.phone.empty() && a.phone == b.phone;
+	// most pairs of a bucket differ in the phone number, which is the cheaper check
+	if (!samePhone && !a.phone.empty() && !b.phone.empty() && Similarity(a.phone, b.phone, PHONE_SIMILARITY) == 0) { return 0; }
+	double minimum = samePhone ? SAME_PHONE_SIMILARITY : NAME_SIMILARITY;
+	double similarity = NameSimilarity(a.name, b.name, minimum);
+	if (similarity < 1 && (a.name != a.sorted || b.name != b.sorted)) { similarity = std::max(similarity, NameSimilarity(a.sorted, b.sorted, minimum)); }
+	return similarity;
+}
+
+// Blocking keys of a contact: the phone number and the bands of its name signature, 0 for none.
+static void Keys(const Normalized & contact, uint64_t * keys)
+{
+	keys[0] = contact.phone.size() >= MIN_PHONE_DIGITS ? Mix(std::stoull(contact.phone) * 16 + contact.phone.size()) | 1 : 0;
+	// signature: per hash function the least hash of a trigram of the padded name
+	std::string name = " " + contact.sorted + " ";
+	uint64_t signature[BANDS * BAND_ROWS];
+	std::fill(signature, signature + BANDS * BAND_ROWS, UINT64_MAX);
+	for (size_t i = 0; i + 3 <= name.size(); ++i)
+	{
+		uint64_t trigram = Mix(static_cast<uint64_t>(static_cast<unsigned char>(name[i])) << 16
+			| static_cast<uint64_t>(static_cast<unsigned char>(name[i + 1])) << 8 | static_cast<unsigned char>(name[i + 2]));
+		for (int k = 0; k < BANDS * BAND_ROWS; ++k) { signature[k] = std::min(signature[k], Mix(trigram ^ (0x9E3779B97F4A7C15ULL * (k + 1)))); }
+	}
+	for (int band = 0; band < BANDS; ++band)
+	{
+		uint64_t key = band + 1;
+		for (int row = 0; row < BAND_ROWS; ++row) { key = Mix(key ^ signature[band * BAND_ROWS + row]); }
+		keys[band + 1] = contact.sorted.empty() ? 0 : key | 1;
+	}
+}
+
+// Whether a and b share a key before the given slot, where the pair is compared instead.
+static bool SharedBefore(const std::vector<uint64_t> & keys, size_t a, size_t b, uint32_t slot)
+{
+	for (uint32_t k = 0; k < slot; ++k)
+	{
+		if (keys[a * KEYS + k] != 0 && keys[a * KEYS + k] == keys[b * KEYS + k]) { return true; }
+	}
+	return false;
+}
+
+std::vector<std::vector<size_t>> ContactDedup::Find(const ContactStore & database, int threads)
+{
+	size_t count = database.Size();
+	threads = std::max(1, threads);
+	std::vector<Normalized> contacts(count);
+	std::vector<uint64_t> keys(count * KEYS);
+	ParallelFor((count + BLOCK - 1) / BLOCK, threads, [&](size_t block)
+	{
+		for (size_t i = block * BLOCK; i < std::min(count, (block + 1) * BLOCK); ++i)
+		{
+			ContactView contact = database.At(i);
+			std::vector<std::string> words = Words(contact);
+			contacts[i].name = Join(words);
+			std::sort(words.begin(), words.end());
+			contacts[i].sorted = Join(words);
+			contacts[i].phone = PhoneKey(contact.phoneNumber);
+			Keys(contacts[i], &keys[i * KEYS]);
+		}
+	});
+
+	// keys are spread over the parts by their top byte, so a bucket lies within one part
+	std::vector<size_t> partStart(PARTS + 1, 0);
+	for (uint64_t key : keys)
+	{
+		if (key != 0) { ++partStart[(key >> 56) + 1]; }
+	}
+	std::partial_sum(partStart.begin(), partStart.end(), partStart.begin());
+	std::vector<KeyEntry> entries(partStart[PARTS]);
+	std::vector<size_t> fill(partStart.begin(), partStart.end() - 1);
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		if (keys[i] != 0) { entries[fill[keys[i] >> 56]++] = { keys[i], static_cast<uint32_t>(i / KEYS), static_cast<uint32_t>(i % KEYS) }; }
+	}
+
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> strong(PARTS);
+	std::vector<std::vector<WeakMatch>> weak(PARTS);
+	ParallelFor(PARTS, threads, [&](size_t part)
+	{
+		KeyEntry * begin = entries.data() + partStart[part], * end = entries.data() + partStart[part + 1];
+		std::sort(begin, end);
+		for (KeyEntry * bucket = begin, * bucketEnd = begin; bucket < end; bucket = bucketEnd)
+		{
+			while (bucketEnd < end && bucketEnd->key == bucket->key) { ++bucketEnd; }
+			size_t size = bucketEnd - bucket;
+			for (size_t i = 0; i < size; ++i)
+			{
+				size_t last = size <= MAX_BUCKET ? size : std::min(size, i + 1 + BUCKET_WINDOW);
+				for (size_t j = i + 1; j < last; ++j)
+				{
+					uint32_t a = bucket[i].position, b = bucket[j].position;
+					bool isWeak;
+					double similarity = SharedBefore(keys, a, b, bucket[i].slot) ? 0 : Duplicates(contacts[a], contacts[b], &isWeak);
+					if (similarity == 0) { continue; }
+					if (!isWeak) { strong[part].emplace_back(a, b); }
+					else if (contacts[a].phone.empty()) { weak[part].push_back({ a, b, similarity }); }
+					else { weak[part].push_back({ b, a, similarity }); }
+				}
+			}
+		}
+	});
+	std::vector<Normalized>().swap(contacts);
+	std::vector<uint64_t>().swap(keys);
+	std::vector<KeyEntry>().swap(entries);
+
+	// union-find, the smallest position becomes the root
+	std::vector<uint32_t> parent(count);
+	std::iota(parent.begin(), parent.end(), 0);
+	auto root = [&parent](uint32_t x)
+	{
+		while (parent[x] != x) { x = parent[x] = parent[parent[x]]; }
+		return x;
+	};
+	auto join = [&parent, &root](uint32_t a, uint32_t b)
+	{
+		a = root(a);
+		b = root(b);
+		if (a != b) { parent[std::max(a, b)] = std::min(a, b); }
+	};
+	for (const auto & pairs : strong)
+	{
+		for (const auto & pair : pairs) { join(pair.first, pair.second); }
+	}
+	// a contact without a phone number joins the group of its best matches, unless they are in several
+	std::vector<WeakMatch> weakMatches;
+	for (const auto & matches : weak) { weakMatches.insert(weakMatches.end(), matches.begin(), matches.end()); }
+	std::sort(weakMatches.begin(), weakMatches.end());
+	for (size_t i = 0, next = 0; i < weakMatches.size(); i = next)
+	{
+		bool single = true;
+		for (next = i + 1; next < weakMatches.size() && weakMatches[next].contact == weakMatches[i].contact; ++next)
+		{
+			if (weakMatches[next].similarity == weakMatches[i].similarity) { single = single && root(weakMatches[next].other) == root(weakMatches[i].other); }
+		}
+		if (single) { join(weakMatches[i].contact, weakMatches[i].other); }
+	}
+
+	std::vector<uint32_t> sizes(count, 0);
+	for (size_t i = 0; i < count; ++i) { ++sizes[root(static_cast<uint32_t>(i))]; }
+	// a root comes first in its group, so the group exists before its other members are met
+	std::vector<std::vector<size_t>> groups;
+	std::unordered_map<uint32_t, size_t> groupOf;
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t r = root(static_cast<uint32_t>(i));
+		if (sizes[r] < 2) { continue; }
+		if (r == i)
+		{
+			groupOf[r] = groups.size();
+			groups.emplace_back();
+		}
+		groups[groupOf[r]].push_back(i);
+	}
+	return groups;
+}
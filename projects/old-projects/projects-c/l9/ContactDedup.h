@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include "ContactStore.h"
+
+//
+// Finds contacts entered more than once with slightly different spellings, without comparing every pair.
+// Names are compared as their lowercase words in sorted order, Polish letters folded to ASCII, so
+// "Kowalski Jan" and "jan kowalsky" come close; phone numbers as their last PHONE_DIGITS digits.
+//
+// Contacts are blocked first: every contact gets a key for its phone number and BANDS keys from a MinHash
+// signature of its name trigrams, each key hashing BAND_ROWS of the signature values. Names sharing most
+// trigrams very likely share a band, unrelated names almost never. Only contacts sharing a key are compared,
+// a pair once, at the first key it shares; a key shared by more than MAX_BUCKET contacts (a common name)
+// compares each of them with the next few only. Signatures, sorting the keys and comparing the pairs all
+// run on the threads, so the work grows with the number of contacts, not its square.
+//
+// A pair is a duplicate when the phone numbers are the same and the names alike, or every word of the names
+// is nearly the same and so are the phone numbers (one wrong digit), or one of them has none. Duplicates are
+// merged into groups with union-find, each group being one merge suggestion. A contact without a phone number
+// joins only the group of its best matches, so it can't tie several people with the same name together.
+//
+
+class ContactDedup
+{
+public:
+	// groups of positions in the store, each sorted, the groups ordered by their first position
+	static std::vector<std::vector<size_t>> Find(const ContactStore & database, int threads);
+};
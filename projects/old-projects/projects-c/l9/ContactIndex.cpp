@@ -0,0 +1,98 @@
+#include "ContactIndex.h"
+#include <climits>
+
+ContactIndex::Key ContactIndex::KeyOf(const ContactView & contact)
+{
+	return Key(contact.surname, contact.name, contact.id);
+}
+
+// Live slots in [0, slot); entry k - 1 of the tree covers the slots k - lowbit(k) .. k - 1.
+size_t ContactIndex::LiveBefore(size_t slot) const
+{
+	size_t count = 0;
+	for (size_t k = slot; k > 0; k &= k - 1) { count += this->live[k - 1]; }
+	return count;
+}
+
+void ContactIndex::Rebuild(const ContactStore & database)
+{
+	this->byId.clear();
+	this->byName.clear();
+	this->byId.reserve(database.Size());
+	// every slot live, each entry adds itself to the one covering it
+	this->live.assign(database.Size(), 1);
+	for (size_t k = 1; k <= this->live.size(); ++k)
+	{
+		size_t parent = k + (k & (0 - k));
+		if (parent <= this->live.size()) { this->live[parent - 1] += this->live[k - 1]; }
+	}
+	for (size_t i = 0; i < database.Size(); ++i)
+	{
+		this->byId[database.At(i).id] = i;
+		this->byName.insert(KeyOf(database.At(i)));
+	}
+}
+
+void ContactIndex::Insert(const ContactView & contact)
+{
+	size_t k = this->live.size() + 1;
+	this->byId[contact.id] = k - 1;
+	this->live.push_back(1 + LiveBefore(k - 1) - LiveBefore(k - (k & (0 - k))));
+	this->byName.insert(KeyOf(contact));
+}
+
+void ContactIndex::Update(const ContactView & before, const ContactView & after)
+{
+	if (before.surname == after.surname && before.name == after.name) { return; }
+	this->byName.erase(KeyOf(before));
+	this->byName.insert(KeyOf(after));
+}
+
+void ContactIndex::Erase(const ContactStore & database, size_t position)
+{
+	auto it = this->byId.find(database.At(position).id);
+	if (it == this->byId.end()) { return; }
+	for (size_t k = it->second + 1; k <= this->live.size(); k += k & (0 - k)) { --this->live[k - 1]; }
+	this->byId.erase(it);
+	this->byName.erase(KeyOf(database.At(position)));
+}
+
+int ContactIndex::Find(int id) const
+{
+	auto it = this->byId.find(id);
+	return it == this->byId.end() ? -1 : static_cast<int>(LiveBefore(it->second));
+}
+
+int ContactIndex::LowerBound(const std::string & surname, const std::string & name) const
+{
+	auto it = this->byName.lower_bound(Key(surname, name, INT_MIN));
+	return it == this->byName.end() ? 0 : std::get<2>(*it);
+}
+
+int ContactIndex::Neighbour(const ContactView & contact, int step) const
+{
+	if (this->byName.empty()) { return 0; }
+	auto it = this->byName.lower_bound(KeyOf(contact));
+	if (it == this->byName.end()) { it = this->byName.begin(); }
+	for (; step > 0; --step)
+	{
+		if (++it == this->byName.end()) { it = this->byName.begin(); }
+	}
+	for (; step < 0; ++step)
+	{
+		if (it == this->byName.begin()) { it = this->byName.end(); }
+		--it;
+	}
+	return std::get<2>(*it);
+}
+
+std::vector<int> ContactIndex::Range(const std::string & from, const std::string & to, size_t limit) const
+{
+	std::vector<int> ids;
+	for (auto it = this->byName.lower_bound(Key(from, std::string_view(), INT_MIN));
+		it != this->byName.end() && std::get<0>(*it) <= to && ids.size() < limit; ++it)
+	{
+		ids.push_back(std::get<2>(*it));
+	}
+	return ids;
+}
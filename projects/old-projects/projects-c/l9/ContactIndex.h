@@ -0,0 +1,47 @@
+#pragma once
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "ContactStore.h"
+
+//
+// Lookup structures over the contact store, kept in step with every create, update and delete.
+// byId   - hash of id -> slot, the order in which the contact came into the store; slots never move, so a
+//          delete doesn't touch the contacts behind it
+// live   - Fenwick tree over the slots, 1 for a contact still there: the position in the store is the count
+//          of live slots before its own, O(log n) to find and to update
+// byName - balanced tree ordered by (surname, name, id), O(log n) search, neighbour and range queries
+// Keys view the strings of the store, which stay in place until it is reloaded.
+//
+
+class ContactIndex
+{
+	typedef std::tuple<std::string_view, std::string_view, int> Key;
+
+	std::unordered_map<int, size_t> byId;
+	std::vector<size_t> live;
+	std::set<Key> byName;
+
+	static Key KeyOf(const ContactView & contact);
+	size_t LiveBefore(size_t slot) const;
+
+public:
+	void Rebuild(const ContactStore & database);
+	// a contact pushed to the back of the store
+	void Insert(const ContactView & contact);
+	void Update(const ContactView & before, const ContactView & after);
+	// call before the contact is erased from the store; positions behind it move one down
+	void Erase(const ContactStore & database, size_t position);
+
+	// position of the contact in the store, -1 when there is none
+	int Find(int id) const;
+	// id of the first contact at or after (surname, name) in order, 0 when there is none
+	int LowerBound(const std::string & surname, const std::string & name) const;
+	// id of the contact step places away in order (wrapping around), 0 when the index is empty
+	int Neighbour(const ContactView & contact, int step) const;
+	// ids of contacts with from <= surname <= to in order, at most limit of them
+	std::vector<int> Range(const std::string & from, const std::string & to, size_t limit) const;
+};
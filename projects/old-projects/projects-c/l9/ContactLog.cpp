@@ -0,0 +1,890 @@
+#include "ContactLog.h"
+#include "RowIndex.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOG_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define LOG_HEADER "#CRUD-LOG 2"
+#define LOG_HEADER_V1 "#CRUD-LOG 1"
+#define MANIFEST_HEADER "#CRUD-MANIFEST 1"
+#define MANIFEST_RETRIES 100
+#define KEPT_SEGMENTS 16 // how far back removal of segments still mapped by readers is retried
+#define COMPACT_MIN_GARBAGE 1000 // below that many garbage records compaction is not worth a rewrite
+#define TAIL_LIMIT (1 << 20) // records behind the base, which Open() and cursors read through
+#define COMMIT_INTERVAL_MS 5
+#define COMMIT_BATCH (1 << 20) // a buffer this big is committed without waiting for the interval
+#define WRITE_CHUNK (1 << 20)
+#define FIELDS 6
+
+static unsigned FirstBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static const char * FindNewline(const char * p, const char * end)
+{
+#ifdef LOG_SSE2
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16)
+	{
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), newline));
+		if (mask != 0) { return p + FirstBit(mask); }
+	}
+#endif
+	if (p == end) { return end; }
+	const char * found = static_cast<const char *>(memchr(p, '\n', end - p));
+	return found != NULL ? found : end;
+}
+
+// Sets the line at p without its line break and moves p past it; false when the line has no line break.
+static bool NextLine(const char ** p, const char * end, std::string_view * line)
+{
+	const char * lineEnd = FindNewline(*p, end);
+	*line = std::string_view(*p, lineEnd - *p);
+	*p = lineEnd < end ? lineEnd + 1 : end;
+	if (!line->empty() && line->back() == '\r') { line->remove_suffix(1); } // text-mode appends on Windows
+	return lineEnd < end;
+}
+
+static std::string_view NextLine(const char ** p, const char * end)
+{
+	std::string_view line;
+	NextLine(p, end, &line);
+	return line;
+}
+
+// Slicing-by-8: eight bytes per step through eight tables, table[k][b] being the CRC of b followed by k zero bytes.
+static uint32_t Crc32(const char * data, size_t size)
+{
+	static const std::vector<uint32_t> table = []()
+	{
+		std::vector<uint32_t> entries(8 * 256);
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; ++bit) { crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1; }
+			entries[i] = crc;
+		}
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			for (int k = 1; k < 8; ++k) { entries[k * 256 + i] = (entries[(k - 1) * 256 + i] >> 8) ^ entries[entries[(k - 1) * 256 + i] & 0xFF]; }
+		}
+		return entries;
+	}();
+	const uint32_t * t = table.data();
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+	uint32_t crc = 0xFFFFFFFFu;
+	for (; size >= 8; p += 8, size -= 8)
+	{
+		uint32_t low = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24);
+		crc = t[7 * 256 + (low & 0xFF)] ^ t[6 * 256 + ((low >> 8) & 0xFF)] ^ t[5 * 256 + ((low >> 16) & 0xFF)] ^ t[4 * 256 + (low >> 24)]
+			^ t[3 * 256 + p[4]] ^ t[2 * 256 + p[5]] ^ t[256 + p[6]] ^ t[p[7]];
+	}
+	for (; size > 0; ++p, --size) { crc = t[(crc ^ *p) & 0xFF] ^ (crc >> 8); }
+	return crc ^ 0xFFFFFFFFu;
+}
+
+// Strips and checks the checksum closing a line; false when it is missing or wrong.
+static bool Verify(std::string_view * line)
+{
+	size_t tab = line->rfind('\t');
+	if (tab == std::string_view::npos) { return false; }
+	uint32_t expected = 0;
+	std::string_view text = line->substr(tab + 1);
+	auto parsed = std::from_chars(text.data(), text.data() + text.size(), expected, 16);
+	if (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size()) { return false; }
+	line->remove_suffix(line->size() - tab);
+	return Crc32(line->data(), line->size()) == expected;
+}
+
+static int Split(std::string_view line, std::string_view * fields)
+{
+	int count = 0;
+	for (size_t start = 0; count < FIELDS; ++count)
+	{
+		size_t tab = line.find('\t', start);
+		fields[count] = line.substr(start, tab == std::string_view::npos ? std::string_view::npos : tab - start);
+		if (tab == std::string_view::npos) { return count + 1; }
+		start = tab + 1;
+	}
+	return count + 1; // more tabs than fields, not a valid record
+}
+
+static int ParseId(std::string_view text)
+{
+	int id = 0;
+	std::from_chars(text.data(), text.data() + text.size(), id);
+	return id;
+}
+
+// Id -> position during replay. Ids are handed out in sequence, so a flat array covers almost all of them
+// at 4 bytes each; ids far above the record count go to a hash.
+class Positions
+{
+	std::vector<uint32_t> dense;
+	std::unordered_map<int, size_t> sparse;
+
+public:
+	explicit Positions(size_t expected) : dense(expected * 2 + 1024, 0) {}
+
+	void Set(int id, size_t position)
+	{
+		if (id > 0 && static_cast<size_t>(id) < dense.size() && position < 0xFFFFFFFF) { dense[id] = static_cast<uint32_t>(position + 1); }
+		else { sparse[id] = position; }
+	}
+
+	long long Get(int id) const
+	{
+		if (id > 0 && static_cast<size_t>(id) < dense.size() && dense[id] != 0) { return dense[id] - 1LL; }
+		auto it = sparse.find(id);
+		return it == sparse.end() ? -1 : static_cast<long long>(it->second);
+	}
+
+	void Erase(int id)
+	{
+		if (id > 0 && static_cast<size_t>(id) < dense.size()) { dense[id] = 0; }
+		sparse.erase(id);
+	}
+};
+
+ContactLog::ContactLog(std::string fileName) : fileName(fileName), compacting(false), stopping(false), urgent(false),
+	failed(false), records(0), live(0), tailRecords(0), generation(0), appended(0), flushed(0), durable(0) {}
+
+ContactLog::~ContactLog()
+{
+	WaitForCompaction();
+	StopCommitter();
+	this->file.Close();
+}
+
+// Replays the records in [begin, end); returns how many were read. With checked records replay stops at the
+// first torn or corrupt line, validEnd is where it stopped.
+long long ContactLog::Replay(const char * begin, const char * end, ContactStore * store, bool checked, const char ** validEnd)
+{
+	// deleted contacts are blanked while replaying and dropped at the end
+	Positions position((end - begin) / 64);
+	std::string_view line;
+	ContactView contact;
+	char type;
+	long long count = 0;
+	const char * p = begin;
+	store->Reserve((end - begin) / 64);
+	while (p < end)
+	{
+		if (!checked)
+		{
+			NextLine(&p, end, &line);
+			type = ParseRecord(line, &contact);
+		}
+		else if (!ReadRecord(&p, end, &type, &contact)) { break; }
+		long long at = position.Get(contact.id);
+		if (type == 'C')
+		{
+			position.Set(contact.id, store->Size());
+			store->Push(contact);
+		}
+		else if (type == 'U' && at >= 0) { store->Set(at, contact); }
+		else if (type == 'D' && at >= 0)
+		{
+			store->MarkDeleted(at);
+			position.Erase(contact.id);
+		}
+		else { continue; }
+		++count;
+	}
+	store->RemoveDeleted();
+	if (validEnd != NULL) { *validEnd = p; }
+	return count;
+}
+
+// Type of the record on the line (without its checksum), 0 when it is none.
+char ContactLog::ParseRecord(std::string_view line, ContactView * contact)
+{
+	std::string_view fields[FIELDS];
+	int fieldCount = Split(line, fields);
+	if (fieldCount < 2 || fields[0].size() != 1) { return 0; }
+	char type = fields[0][0];
+	if ((type == 'C' || type == 'U') && fieldCount == 5) { *contact = ContactView(fields[2], fields[3], fields[4], ParseId(fields[1])); }
+	else if (type == 'D') { *contact = ContactView(std::string_view(), std::string_view(), std::string_view(), ParseId(fields[1])); }
+	else { return 0; }
+	return type;
+}
+
+bool ContactLog::ReadRecord(const char ** p, const char * end, char * type, ContactView * contact)
+{
+	std::string_view line;
+	const char * next = *p;
+	if (!NextLine(&next, end, &line) || !Verify(&line)) { return false; }
+	*type = ParseRecord(line, contact);
+	*p = next;
+	return true;
+}
+
+// The old format: id, name, surname and phone number on four lines.
+void ContactLog::ReadLegacy(const char * begin, const char * end, std::vector<Contacts> * database)
+{
+	std::string_view lines[4];
+	for (const char * p = begin; p < end;)
+	{
+		int checker = 0;
+		for (; checker < 4 && p < end; ++checker) { lines[checker] = NextLine(&p, end); }
+		if (checker == 4) { database->push_back(ContactView(lines[1], lines[2], lines[3], ParseId(lines[0])).Materialize()); }
+	}
+}
+
+static void AppendField(std::string * out, std::string_view field)
+{
+	out->push_back('\t');
+	size_t start = out->size();
+	out->append(field.data(), field.size());
+	for (size_t i = start; i < out->size(); ++i)
+	{
+		if ((*out)[i] == '\t' || (*out)[i] == '\n' || (*out)[i] == '\r') { (*out)[i] = ' '; }
+	}
+}
+
+// Appends one record line closed by its checksum.
+void ContactLog::Format(std::string * out, char type, const ContactView & contact)
+{
+	size_t start = out->size();
+	out->push_back(type);
+	out->push_back('\t');
+	out->append(std::to_string(contact.id));
+	if (type != 'D')
+	{
+		AppendField(out, contact.name);
+		AppendField(out, contact.surname);
+		AppendField(out, contact.phoneNumber);
+	}
+	char checksum[16];
+	snprintf(checksum, sizeof(checksum), "\t%08x\n", Crc32(out->data() + start, out->size() - start));
+	out->append(checksum);
+}
+
+static std::streamoff FileSize(const std::string & fileName)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+	return file.good() ? static_cast<std::streamoff>(file.tellg()) : 0;
+}
+
+bool ContactLog::ReplaceFile(const std::string & from, const std::string & to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (std::rename(from.c_str(), to.c_str()) != 0) { return false; }
+	// the rename itself is only durable once the directory is synced
+	size_t slash = to.rfind('/');
+	int directory = open(slash == std::string::npos ? "." : to.substr(0, slash + 1).c_str(), O_RDONLY);
+	if (directory >= 0)
+	{
+		fsync(directory);
+		close(directory);
+	}
+	return true;
+#endif
+}
+
+std::string ContactLog::SegmentName(const std::string & fileName, unsigned long long generation)
+{
+	return fileName + "." + std::to_string(generation);
+}
+
+bool ContactLog::ReadManifest(const std::string & fileName, unsigned long long * generation)
+{
+	std::ifstream manifest(fileName, std::ios::in | std::ios::binary);
+	std::string header;
+	std::getline(manifest, header);
+	if (!header.empty() && header.back() == '\r') { header.pop_back(); }
+	return header == MANIFEST_HEADER && manifest >> *generation && *generation > 0;
+}
+
+// Maps a segment and replays it up to its last complete record; returns the record count, -1 when it can't
+// be read.
+long long ContactLog::ReadSegment(const std::string & segmentName, ContactStore * store, const char ** validEnd)
+{
+	if (!store->Map(segmentName)) { return -1; }
+	const char * p = store->Begin();
+	if (NextLine(&p, store->End()) != LOG_HEADER)
+	{
+		store->Clear();
+		return -1;
+	}
+	return Replay(p, store->End(), store, true, validEnd);
+}
+
+bool ContactLog::WriteManifest(unsigned long long generation)
+{
+	std::string temporary = this->fileName + ".tmp", content = MANIFEST_HEADER "\n" + std::to_string(generation) + "\n";
+	AppendFile out;
+	bool written = out.Open(temporary, true) && out.Write(content.data(), content.size()) && out.Sync();
+	out.Close();
+	// on Windows a reader reading the manifest at that moment makes the rename fail, it is over in a moment
+	for (int attempt = 0; written && attempt < MANIFEST_RETRIES; ++attempt)
+	{
+		if (ReplaceFile(temporary, this->fileName)) { return true; }
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	std::remove(temporary.c_str());
+	return false;
+}
+
+// Segments older than the current one are removed once no reader maps them (POSIX unlinks them right away).
+void ContactLog::RemoveOldSegments()
+{
+	for (unsigned long long old = this->generation - 1; old > 0 && old + KEPT_SEGMENTS >= this->generation; --old)
+	{
+		std::remove(SegmentName(this->fileName, old).c_str());
+		std::remove(RowsName(SegmentName(this->fileName, old)).c_str());
+	}
+}
+
+std::string ContactLog::RowsName(const std::string & segmentName)
+{
+	return segmentName + ".rows";
+}
+
+// Writes a new segment: the live contacts with an entry in the row index each, then anything appended.
+class ContactLog::SegmentWriter
+{
+	std::string segmentName, buffer, entries;
+	AppendFile segment, rows;
+	RowTrailer trailer;
+	uint64_t written;
+	bool good;
+
+	void Flush()
+	{
+		this->good = this->good && this->segment.Write(this->buffer.data(), this->buffer.size());
+		this->written += this->buffer.size();
+		this->buffer.clear();
+	}
+
+public:
+	explicit SegmentWriter(const std::string & segmentName) : segmentName(segmentName), buffer(LOG_HEADER "\n"), written(0)
+	{
+		this->trailer = RowTrailer();
+		this->trailer.ascending = 1;
+		this->trailer.magic = ROW_INDEX_MAGIC;
+		this->good = this->segment.Open(segmentName, true) && this->rows.Open(RowsName(segmentName), true);
+	}
+
+	void Add(const ContactView & contact)
+	{
+		RowEntry entry;
+		entry.offset = this->written + this->buffer.size();
+		entry.id = contact.id;
+		Format(&this->buffer, 'C', contact);
+		entry.length = static_cast<uint32_t>(this->written + this->buffer.size() - entry.offset);
+		if (this->trailer.rows > 0 && contact.id <= this->trailer.maxId) { this->trailer.ascending = 0; }
+		this->trailer.maxId = this->trailer.rows > 0 ? std::max(this->trailer.maxId, contact.id) : contact.id;
+		++this->trailer.rows;
+		this->entries.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+		if (this->buffer.size() >= WRITE_CHUNK) { Flush(); }
+		if (this->entries.size() >= WRITE_CHUNK)
+		{
+			this->good = this->good && this->rows.Write(this->entries.data(), this->entries.size());
+			this->entries.clear();
+		}
+	}
+
+	// Ends the base and completes the row index.
+	bool EndRows()
+	{
+		Flush();
+		this->trailer.baseLength = this->written;
+		this->entries.append(reinterpret_cast<const char *>(&this->trailer), sizeof(this->trailer));
+		this->good = this->good && this->rows.Write(this->entries.data(), this->entries.size()) && this->rows.Sync();
+		this->rows.Close();
+		return this->good;
+	}
+
+	// Takes the base of an intact segment over unchanged; the header is the same, so are the row offsets.
+	void CopyBase(const char * data, const RowEntry * entries, const RowTrailer & base)
+	{
+		Flush();
+		this->good = this->good && this->segment.Write(data + this->written, static_cast<size_t>(base.baseLength - this->written));
+		this->written = base.baseLength;
+		this->good = this->good && this->rows.Write(reinterpret_cast<const char *>(entries), static_cast<size_t>(base.rows * sizeof(RowEntry)));
+		this->trailer.rows = base.rows;
+		this->trailer.maxId = base.maxId;
+		this->trailer.ascending = base.ascending;
+	}
+
+	// Adds formatted create records to the base.
+	void AddBlock(const ImportBlock & block)
+	{
+		uint64_t at = this->written + this->buffer.size();
+		for (RowEntry entry : block.rows)
+		{
+			entry.offset += at;
+			if (this->trailer.rows > 0 && entry.id <= this->trailer.maxId) { this->trailer.ascending = 0; }
+			this->trailer.maxId = this->trailer.rows > 0 ? std::max(this->trailer.maxId, entry.id) : entry.id;
+			++this->trailer.rows;
+			this->entries.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+		}
+		this->buffer.append(block.records);
+		if (this->buffer.size() >= WRITE_CHUNK) { Flush(); }
+		if (this->entries.size() >= WRITE_CHUNK)
+		{
+			this->good = this->good && this->rows.Write(this->entries.data(), this->entries.size());
+			this->entries.clear();
+		}
+	}
+
+	bool Append(const char * data, size_t size)
+	{
+		return this->good = this->good && this->segment.Write(data, size);
+	}
+
+	// Appends the bytes of another file from offset from up to offset to.
+	bool Copy(const std::string & fileName, std::streamoff from, std::streamoff to)
+	{
+		std::ifstream in(fileName, std::ios::in | std::ios::binary);
+		in.seekg(from);
+		std::vector<char> chunk(WRITE_CHUNK);
+		for (std::streamoff left = to - from; this->good && left > 0;)
+		{
+			std::streamsize size = static_cast<std::streamsize>(std::min<std::streamoff>(left, WRITE_CHUNK));
+			this->good = in.read(chunk.data(), size) && this->segment.Write(chunk.data(), static_cast<size_t>(size));
+			left -= size;
+		}
+		return this->good;
+	}
+
+	bool Sync()
+	{
+		return this->good = this->good && this->segment.Sync();
+	}
+
+	// Syncs the segment; a segment that failed is removed with its index.
+	bool Finish()
+	{
+		this->good = this->good && this->segment.Sync();
+		this->segment.Close();
+		this->rows.Close();
+		if (!this->good)
+		{
+			std::remove(this->segmentName.c_str());
+			std::remove(RowsName(this->segmentName).c_str());
+		}
+		return this->good;
+	}
+};
+
+// Writes the contacts into the next segment and makes it current.
+bool ContactLog::Rewrite(const ContactStore & database)
+{
+	std::string segment = SegmentName(this->fileName, this->generation + 1);
+	SegmentWriter out(segment);
+	for (size_t i = 0; i < database.Size(); ++i) { out.Add(database.At(i)); }
+	if (out.EndRows() && out.Finish() && WriteManifest(this->generation + 1))
+	{
+		++this->generation;
+		RemoveOldSegments();
+		return true;
+	}
+	std::remove(segment.c_str());
+	std::remove(RowsName(segment).c_str());
+	return false;
+}
+
+// Checks the records of a segment from offset from on; returns how many there are, -1 when one of them is
+// torn or corrupt.
+long long ContactLog::ScanTail(const std::string & segmentName, uint64_t from, long long * liveChange)
+{
+	MappedFile segment;
+	if (!segment.Open(segmentName) || segment.Size() < from) { return -1; }
+	long long count = 0;
+	*liveChange = 0;
+	char type;
+	ContactView contact;
+	for (const char * p = segment.Data() + from, * end = segment.Data() + segment.Size(); p < end; ++count)
+	{
+		if (!ReadRecord(&p, end, &type, &contact)) { return -1; }
+		*liveChange += type == 'C' ? 1 : type == 'D' ? -1 : 0;
+	}
+	return count;
+}
+
+// Makes the manifest name an intact segment with a row index and counts its records from the index and
+// the tail behind the base; returns the segment name. Called with both locks held.
+std::string ContactLog::Prepare()
+{
+	if (!ReadManifest(this->fileName, &this->generation))
+	{
+		// a single-file database from before segments
+		ContactStore store, converted;
+		if (!store.Map(this->fileName)) throw new std::exception("Read() - can't open file.");
+		const char * p = store.Begin();
+		std::string_view header = NextLine(&p, store.End());
+		if (header == LOG_HEADER || header == LOG_HEADER_V1)
+		{
+			Replay(p, store.End(), &store, header == LOG_HEADER, NULL);
+			for (size_t i = 0; i < store.Size(); ++i) { converted.Push(store.At(i)); }
+		}
+		else
+		{
+			std::vector<Contacts> contacts;
+			ReadLegacy(store.Begin(), store.End(), &contacts);
+			for (const auto & contact : contacts) { converted.Push(contact); }
+		}
+		store.Clear(); // nothing may map the file while it is replaced
+		this->generation = 0;
+		if (!Rewrite(converted)) throw new std::exception("Rewrite() - can't write file.");
+	}
+	std::string segment = SegmentName(this->fileName, this->generation);
+	MappedFile rows;
+	RowTrailer trailer;
+	long long tail = -1, liveChange = 0;
+	if (rows.Open(RowsName(segment)) && ReadRowTrailer(rows.Data(), rows.Size(), &trailer))
+	{
+		tail = ScanTail(segment, trailer.baseLength, &liveChange);
+	}
+	rows.Close();
+	if (tail < 0)
+	{
+		// a write torn by a crash, or a segment from before row indexes: the intact records move to a new
+		// segment, readers may still map this one
+		ContactStore store;
+		if (ReadSegment(segment, &store, NULL) < 0) throw new std::exception("Read() - can't open file.");
+		if (!Rewrite(store)) throw new std::exception("Rewrite() - can't write file.");
+		segment = SegmentName(this->fileName, this->generation);
+		trailer.rows = store.Size();
+		tail = liveChange = 0;
+	}
+	RemoveOldSegments();
+	this->records = static_cast<long long>(trailer.rows) + tail;
+	this->live = static_cast<long long>(trailer.rows) + liveChange;
+	this->tailRecords = tail;
+	return segment;
+}
+
+void ContactLog::Start(const std::string & segmentName)
+{
+	if (!this->file.Open(segmentName, false)) throw new std::exception("Load() - can't open file for writing.");
+	this->appended = this->flushed = this->durable = 0;
+	this->failed = false;
+	this->committer = std::thread(&ContactLog::Commit, this);
+	Appended(0);
+}
+
+void ContactLog::Open()
+{
+	WaitForCompaction();
+	StopCommitter();
+	std::lock_guard<std::mutex> files(this->fileLock);
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->file.Close();
+	Start(Prepare());
+}
+
+void ContactLog::Load(ContactStore * store)
+{
+	WaitForCompaction();
+	StopCommitter();
+	std::lock_guard<std::mutex> files(this->fileLock);
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->file.Close();
+	std::string segment = Prepare();
+	this->records = ReadSegment(segment, store, NULL);
+	if (this->records < 0) throw new std::exception("Read() - can't open file.");
+	this->live = store->Size();
+	Start(segment);
+}
+
+// Committer thread: one write and one sync for everything appended during an interval.
+void ContactLog::Commit()
+{
+	std::string batch;
+	std::unique_lock<std::mutex> guard(this->lock);
+	while (true)
+	{
+		this->commitSignal.wait_for(guard, std::chrono::milliseconds(COMMIT_INTERVAL_MS), [this]() { return this->stopping || this->urgent; });
+		this->urgent = false;
+		// Flush() may have written edits already, they still need their sync
+		if (this->pending.empty() && this->flushed <= this->durable)
+		{
+			if (this->stopping) { return; }
+			continue;
+		}
+		// the file lock comes first; compaction may hold it and drain the buffer meanwhile
+		guard.unlock();
+		std::lock_guard<std::mutex> files(this->fileLock);
+		guard.lock();
+		batch.swap(this->pending);
+		unsigned long long sequence = this->appended;
+		guard.unlock();
+		bool written = this->file.Write(batch.data(), batch.size()) && this->file.Sync();
+		batch.clear();
+		guard.lock();
+		if (!written) { this->failed = true; }
+		this->durable = std::max(this->durable, sequence);
+		this->durableSignal.notify_all();
+	}
+}
+
+void ContactLog::StopCommitter()
+{
+	if (!this->committer.joinable()) { return; }
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->stopping = true;
+	}
+	this->commitSignal.notify_one();
+	this->committer.join();
+	this->stopping = false;
+}
+
+// Called with the lock held after every record.
+void ContactLog::Appended(long long liveChange)
+{
+	this->live += liveChange;
+	// a long tail is compacted into the base too, it is read whenever the log or a cursor is opened
+	long long tailLimit = std::min<long long>(TAIL_LIMIT, this->records - this->tailRecords);
+	if ((this->records - this->live <= std::max<long long>(COMPACT_MIN_GARBAGE, this->live)
+		&& this->tailRecords <= std::max<long long>(COMPACT_MIN_GARBAGE, tailLimit)) || this->compacting) { return; }
+	if (this->compactor.joinable()) { this->compactor.join(); } // the previous run already released the lock
+	this->compacting = true;
+	this->compactor = std::thread(&ContactLog::Compact, this);
+}
+
+// Writes and syncs the buffered edits right away; called with both locks held.
+void ContactLog::Drain()
+{
+	if (this->pending.empty()) { return; }
+	if (!this->file.Write(this->pending.data(), this->pending.size()) || !this->file.Sync()) { this->failed = true; }
+	this->pending.clear();
+	this->durable = this->appended;
+	this->durableSignal.notify_all();
+}
+
+// Copies what was written to the current segment from offset *from on into out and syncs it, without the
+// locks; *from moves to the end of the copy.
+bool ContactLog::CopyWritten(SegmentWriter * out, const std::string & current, std::streamoff * from)
+{
+	std::streamoff to;
+	{
+		// whole batches are written under the file lock, so its size is at the end of a record
+		std::lock_guard<std::mutex> files(this->fileLock);
+		to = FileSize(current);
+	}
+	bool copied = out->Copy(current, *from, to) && out->Sync();
+	*from = to;
+	return copied;
+}
+
+// Copies the rest of the current segment from offset from into out and makes out the next segment; called
+// with both locks held, out already holds and has synced all but the last few records.
+bool ContactLog::Publish(SegmentWriter * out, const std::string & current, std::streamoff from, bool written)
+{
+	std::string segment = SegmentName(this->fileName, this->generation + 1);
+	written = written && out->Copy(current, from, FileSize(current));
+	written = out->Finish() && written;
+	if (!written || !WriteManifest(this->generation + 1))
+	{
+		std::remove(segment.c_str());
+		std::remove(RowsName(segment).c_str());
+		return false;
+	}
+	++this->generation;
+	this->file.Close();
+	if (!this->file.Open(segment, false)) { this->failed = true; }
+	// flushed edits were copied into the synced segment
+	this->durable = std::max(this->durable, this->flushed);
+	this->durableSignal.notify_all();
+	RemoveOldSegments();
+	return true;
+}
+
+void ContactLog::Compact()
+{
+	std::string current, segment;
+	std::streamoff end;
+	long long recordsAtStart;
+	{
+		// everything appended so far goes into the file, so the replayed prefix holds all counted records;
+		// the committer finds nothing left to commit, so waiting Sync() calls are released here
+		std::lock_guard<std::mutex> files(this->fileLock);
+		std::lock_guard<std::mutex> guard(this->lock);
+		Drain();
+		current = SegmentName(this->fileName, this->generation);
+		segment = SegmentName(this->fileName, this->generation + 1);
+		end = FileSize(current);
+		recordsAtStart = this->records;
+	}
+
+	// the expensive part runs without the locks, edits keep appending behind offset end; the records
+	// appended meanwhile are copied and the segment synced before the locks are taken again
+	ContactStore database;
+	SegmentWriter out(segment);
+	bool written = database.Map(current);
+	if (written)
+	{
+		const char * p = database.Begin(), * mappedEnd = p + std::min<std::streamoff>(database.End() - p, end);
+		NextLine(&p, mappedEnd);
+		Replay(p, mappedEnd, &database, true, NULL);
+	}
+	for (size_t i = 0; written && i < database.Size(); ++i) { out.Add(database.At(i)); }
+	written = written && out.EndRows();
+	long long liveCount = static_cast<long long>(database.Size());
+	database.Clear();
+	written = written && CopyWritten(&out, current, &end);
+
+	{
+		// edits only wait for the records of the last moment to be copied and synced
+		std::lock_guard<std::mutex> files(this->fileLock);
+		std::lock_guard<std::mutex> guard(this->lock);
+		if (Publish(&out, current, end, written))
+		{
+			this->tailRecords = this->records - recordsAtStart;
+			this->records = liveCount + this->tailRecords;
+		}
+	}
+	this->compacting = false;
+}
+
+long long ContactLog::Import(const std::function<bool(int firstId, ImportBlock * block)> & next)
+{
+	WaitForCompaction();
+	std::string current, segment;
+	MappedFile old, oldRows;
+	RowTrailer base;
+	{
+		std::lock_guard<std::mutex> files(this->fileLock);
+		std::lock_guard<std::mutex> guard(this->lock);
+		Drain();
+		current = SegmentName(this->fileName, this->generation);
+		segment = SegmentName(this->fileName, this->generation + 1);
+		if (!old.Open(current) || !oldRows.Open(RowsName(current)) || !ReadRowTrailer(oldRows.Data(), oldRows.Size(), &base)
+			|| base.baseLength > old.Size())
+		{
+			return -1;
+		}
+		// no compaction starts meanwhile, it would write the same segment
+		this->compacting = true;
+	}
+
+	// new ids go above those created behind the base as well
+	int maxId = base.rows > 0 ? base.maxId : 0;
+	char type;
+	ContactView contact;
+	for (const char * p = old.Data() + base.baseLength, * end = old.Data() + old.Size(); p < end && ReadRecord(&p, end, &type, &contact);)
+	{
+		if (type == 'C') { maxId = std::max(maxId, contact.id); }
+	}
+	// the segment is built without the locks like a compaction, edits keep appending behind the mapping
+	SegmentWriter out(segment);
+	out.CopyBase(old.Data(), reinterpret_cast<const RowEntry *>(oldRows.Data()), base);
+	long long imported = 0;
+	ImportBlock block;
+	while (next(maxId + 1 + static_cast<int>(imported), &block))
+	{
+		out.AddBlock(block);
+		imported += block.rows.size();
+		block.records.clear();
+		block.rows.clear();
+	}
+	bool written = out.EndRows() && out.Append(old.Data() + base.baseLength, static_cast<size_t>(old.Size() - base.baseLength));
+	std::streamoff end = static_cast<std::streamoff>(old.Size());
+	old.Close();
+	oldRows.Close();
+	written = written && CopyWritten(&out, current, &end);
+
+	bool published;
+	{
+		std::lock_guard<std::mutex> files(this->fileLock);
+		std::lock_guard<std::mutex> guard(this->lock);
+		published = Publish(&out, current, end, written);
+		if (published)
+		{
+			this->records += imported;
+			this->live += imported;
+		}
+	}
+	this->compacting = false;
+	return published ? imported : -1;
+}
+
+void ContactLog::WaitForCompaction()
+{
+	if (this->compactor.joinable()) { this->compactor.join(); }
+}
+
+void ContactLog::Append(char type, const ContactView & contact, long long liveChange)
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	Format(&this->pending, type, contact);
+	++this->records;
+	++this->tailRecords;
+	++this->appended;
+	if (this->pending.size() >= COMMIT_BATCH)
+	{
+		this->urgent = true;
+		this->commitSignal.notify_one();
+	}
+	Appended(liveChange);
+}
+
+void ContactLog::AppendCreate(const ContactView & contact) { Append('C', contact, 1); }
+
+void ContactLog::AppendUpdate(const ContactView & contact) { Append('U', contact, 0); }
+
+void ContactLog::AppendDelete(int id) { Append('D', ContactView(std::string_view(), std::string_view(), std::string_view(), id), -1); }
+
+// Writes the buffered edits into the file without waiting for the disk, so readers of the segment see them;
+// the committer still syncs them with its next group.
+void ContactLog::Flush()
+{
+	std::lock_guard<std::mutex> files(this->fileLock);
+	std::lock_guard<std::mutex> guard(this->lock);
+	if (!this->pending.empty())
+	{
+		if (!this->file.Write(this->pending.data(), this->pending.size())) { this->failed = true; }
+		this->pending.clear();
+		this->flushed = this->appended;
+	}
+	if (this->failed) throw new std::exception("Flush() - can't write file.");
+}
+
+// Waits until every edit made so far is on disk.
+void ContactLog::Sync()
+{
+	std::unique_lock<std::mutex> guard(this->lock);
+	unsigned long long target = this->appended;
+	this->urgent = true;
+	this->commitSignal.notify_one();
+	this->durableSignal.wait(guard, [this, target]() { return this->durable >= target || this->failed || !this->committer.joinable(); });
+	if (this->failed) throw new std::exception("Sync() - can't write file.");
+}
+
+long long ContactLog::Garbage()
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->records - this->live;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "AppendFile.h"
+#include "ContactStore.h"
+#include "RowIndex.h"
+
+//
+// Append-only contact database.
+// The database file itself is a manifest naming the current segment, db.txt -> db.txt.7:
+//
+// #CRUD-MANIFEST 1
+// 7
+//
+// Every edit is one line appended to the segment, fields separated by tabs and closed by the CRC32 of the rest:
+//
+// #CRUD-LOG 2
+// C	1	Name	Surname	777666555	f8707354     create
+// U	1	Name	Other	777666555	5f9f7db1     update
+// D	1	08ce477d                             delete (tombstone)
+//
+// Load() maps the file and replays the lines in order to rebuild the database; lines are found with SSE2
+// and records are views into the mapping, nothing is copied. Replay stops at the first line that is cut
+// short or fails its checksum - what a crash in the middle of a write leaves behind - and the intact records
+// move to a new segment. Single-file databases (a log, or the old four-lines-per-contact format) are
+// converted once when they are opened.
+//
+// Every segment is written with a row index (RowIndex.h) next to it. Open() prepares the log for appending
+// from the index and the records behind the base alone, so it takes the same time for any size of database;
+// ContactCursor browses the rows the same way.
+//
+// Edits only append to a memory buffer. A committer thread writes the buffer and syncs the file once per
+// COMMIT_INTERVAL_MS, so one fsync covers every edit of the interval; Sync() waits until all edits made so
+// far are on disk, Flush() only writes them into the file for the readers of the segment.
+//
+// Written bytes of a segment never change and a segment is only replaced by writing the next one, syncing
+// it and renaming a new manifest over the old. Any number of reader processes can therefore open a
+// ContactSnapshot alongside the single writer without locks: they map the current segment and replay the
+// complete records, a torn record still being written ends their snapshot.
+//
+// Import() adds contacts in bulk without going through the buffer: the base is copied into the next segment
+// as it is, the new contacts are added to it and the records behind the old base follow them. The row index
+// only covers a base, so an import costs a copy of the database; it is written without the locks the way
+// compaction is, and edits only wait for its switch.
+//
+// Superseded records and tombstones are garbage. Once garbage outgrows the live contacts, or the records
+// behind the base grow longer than the base or TAIL_LIMIT, a background thread replays the log up to that
+// point into the next segment holding only live contacts, copies over whatever was appended in the meantime
+// and syncs it. Edits only wait while the records of the last moment are copied and synced and the manifest
+// is switched.
+//
+
+class ContactLog
+{
+	std::string fileName;
+	AppendFile file;
+	std::string pending;
+	// fileLock guards the file and is taken before lock, which guards everything else
+	std::mutex fileLock, lock;
+	std::condition_variable commitSignal, durableSignal;
+	std::thread committer, compactor;
+	std::atomic<bool> compacting;
+	bool stopping, urgent, failed;
+	long long records, live, tailRecords; // tailRecords - behind the base of the segment
+	unsigned long long generation, appended, flushed, durable;
+
+	class SegmentWriter;
+
+	static long long Replay(const char * begin, const char * end, ContactStore * store, bool checked, const char ** validEnd);
+	static char ParseRecord(std::string_view line, ContactView * contact);
+	static void ReadLegacy(const char * begin, const char * end, std::vector<Contacts> * database);
+	static bool ReplaceFile(const std::string & from, const std::string & to);
+	static long long ScanTail(const std::string & segmentName, uint64_t from, long long * liveChange);
+	bool WriteManifest(unsigned long long generation);
+	void RemoveOldSegments();
+	bool Rewrite(const ContactStore & database);
+	std::string Prepare();
+	void Start(const std::string & segmentName);
+	void Append(char type, const ContactView & contact, long long liveChange);
+	void Appended(long long liveChange);
+	void Commit();
+	void StopCommitter();
+	void Drain();
+	bool CopyWritten(SegmentWriter * out, const std::string & current, std::streamoff * from);
+	bool Publish(SegmentWriter * out, const std::string & current, std::streamoff from, bool written);
+	void Compact();
+	void WaitForCompaction();
+
+public:
+	// create records in the format of the log, with row entries whose offsets are relative to records
+	struct ImportBlock
+	{
+		std::string records;
+		std::vector<RowEntry> rows;
+	};
+
+	static std::string SegmentName(const std::string & fileName, unsigned long long generation);
+	static bool ReadManifest(const std::string & fileName, unsigned long long * generation);
+	static long long ReadSegment(const std::string & segmentName, ContactStore * store, const char ** validEnd);
+	static std::string RowsName(const std::string & segmentName);
+	// reads the checked record at p and moves p past it; false when it is torn or corrupt, type 0 when the
+	// line is intact but not a record
+	static bool ReadRecord(const char ** p, const char * end, char * type, ContactView * contact);
+	// appends one record line closed by its checksum
+	static void Format(std::string * out, char type, const ContactView & contact);
+
+	explicit ContactLog(std::string fileName);
+	~ContactLog();
+	// ready for appending without reading the contacts
+	void Open();
+	void Load(ContactStore * store);
+	void AppendCreate(const ContactView & contact);
+	void AppendUpdate(const ContactView & contact);
+	void AppendDelete(int id);
+	void Flush();
+	void Sync();
+	long long Garbage();
+	// Adds contacts in bulk into the next segment: the base is copied over, next() fills blocks with the
+	// contacts that follow, given the id of the first, until it returns false. Returns how many were added,
+	// -1 when the segment can't be written.
+	long long Import(const std::function<bool(int firstId, ImportBlock * block)> & next);
+};
@@ -0,0 +1,39 @@
+#include "ContactSnapshot.h"
+#include <fstream>
+#include "ContactLog.h"
+#define OPEN_RETRIES 8 // the writer can replace the segment between reading the manifest and mapping it
+
+ContactSnapshot::ContactSnapshot(std::string fileName) : fileName(fileName), generation(0), length(0) {}
+
+bool ContactSnapshot::Open()
+{
+	for (int attempt = 0; attempt < OPEN_RETRIES; ++attempt)
+	{
+		unsigned long long current;
+		if (!ContactLog::ReadManifest(this->fileName, &current)) { return false; }
+		const char * validEnd;
+		if (ContactLog::ReadSegment(ContactLog::SegmentName(this->fileName, current), &this->store, &validEnd) < 0) { continue; }
+		this->generation = current;
+		this->length = validEnd - this->store.Begin();
+		return true;
+	}
+	return false;
+}
+
+bool ContactSnapshot::Refresh()
+{
+	unsigned long long current;
+	if (!ContactLog::ReadManifest(this->fileName, &current)) { return false; }
+	if (current == this->generation)
+	{
+		std::ifstream segment(ContactLog::SegmentName(this->fileName, current), std::ios::in | std::ios::binary | std::ios::ate);
+		if (static_cast<unsigned long long>(segment.tellg()) == static_cast<unsigned long long>(this->store.End() - this->store.Begin())) { return false; }
+	}
+	return Open();
+}
+
+const ContactStore & ContactSnapshot::Contacts() const { return this->store; }
+
+unsigned long long ContactSnapshot::Generation() const { return this->generation; }
+
+unsigned long long ContactSnapshot::Length() const { return this->length; }
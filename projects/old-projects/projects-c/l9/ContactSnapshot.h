@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include "ContactStore.h"
+
+//
+// Read-only view of the contact database as it was at one moment, for processes that only query it.
+// Open() maps the current segment and replays its complete records; the writer keeps appending and may
+// switch to a new segment meanwhile without disturbing the snapshot. Refresh() moves to the latest state.
+// The version (generation, length) grows with every edit the snapshot includes.
+//
+
+class ContactSnapshot
+{
+	std::string fileName;
+	ContactStore store;
+	unsigned long long generation, length;
+
+public:
+	explicit ContactSnapshot(std::string fileName);
+	bool Open();
+	// returns true when the database changed since the snapshot was taken (and the snapshot moved on)
+	bool Refresh();
+	const ContactStore & Contacts() const;
+	unsigned long long Generation() const;
+	unsigned long long Length() const;
+};
@@ -0,0 +1,140 @@
+#include "ContactStore.h"
+#include <algorithm>
+#include <cstring>
+#define ARENA_CHUNK (1 << 16)
+#define ARENA_BIT (1ULL << 63)
+
+ContactStore::ContactStore() : chunkUsed(0), chunkSize(0) {}
+
+bool ContactStore::Map(const std::string & fileName)
+{
+	Clear();
+	return this->mapping.Open(fileName);
+}
+
+void ContactStore::Clear()
+{
+	this->ids.clear();
+	this->offsets.clear();
+	this->nameLengths.clear();
+	this->surnameLengths.clear();
+	this->phoneLengths.clear();
+	this->chunks.clear();
+	this->chunkUsed = this->chunkSize = 0;
+	this->mapping.Close();
+}
+
+const char * ContactStore::Begin() const { return this->mapping.Data(); }
+
+const char * ContactStore::End() const { return this->mapping.Data() + this->mapping.Size(); }
+
+// Returns the offset of the fields; views of a laid-out record in the mapping are used in place.
+uint64_t ContactStore::Place(const ContactView & contact)
+{
+	const char * begin = Begin(), * end = End();
+	if (contact.name.data() >= begin && contact.name.data() < end
+		&& contact.surname.data() == contact.name.data() + contact.name.size() + 1
+		&& contact.phoneNumber.data() == contact.surname.data() + contact.surname.size() + 1
+		&& contact.phoneNumber.data() + contact.phoneNumber.size() <= end)
+	{
+		return static_cast<uint64_t>(contact.name.data() - begin);
+	}
+
+	size_t size = contact.name.size() + contact.surname.size() + contact.phoneNumber.size() + 2;
+	if (this->chunks.empty() || this->chunkUsed + size > this->chunkSize)
+	{
+		this->chunkSize = std::max<size_t>(ARENA_CHUNK, size);
+		this->chunks.emplace_back(new char[this->chunkSize]);
+		this->chunkUsed = 0;
+	}
+	char * p = this->chunks.back().get() + this->chunkUsed;
+	uint64_t offset = ARENA_BIT | static_cast<uint64_t>(this->chunks.size() - 1) << 32 | this->chunkUsed;
+	memcpy(p, contact.name.data(), contact.name.size());
+	p += contact.name.size();
+	*p++ = '\t';
+	memcpy(p, contact.surname.data(), contact.surname.size());
+	p += contact.surname.size();
+	*p++ = '\t';
+	memcpy(p, contact.phoneNumber.data(), contact.phoneNumber.size());
+	this->chunkUsed += size;
+	return offset;
+}
+
+const char * ContactStore::Address(uint64_t offset) const
+{
+	if (offset & ARENA_BIT) { return this->chunks[(offset & ~ARENA_BIT) >> 32].get() + (offset & 0xFFFFFFFFULL); }
+	return Begin() + offset;
+}
+
+size_t ContactStore::Size() const { return this->ids.size(); }
+
+bool ContactStore::Empty() const { return this->ids.empty(); }
+
+ContactView ContactStore::At(size_t index) const
+{
+	const char * name = Address(this->offsets.at(index));
+	const char * surname = name + this->nameLengths[index] + 1;
+	const char * phoneNumber = surname + this->surnameLengths[index] + 1;
+	return ContactView(std::string_view(name, this->nameLengths[index]), std::string_view(surname, this->surnameLengths[index]),
+		std::string_view(phoneNumber, this->phoneLengths[index]), this->ids[index]);
+}
+
+ContactView ContactStore::Back() const { return At(Size() - 1); }
+
+void ContactStore::Push(const ContactView & contact)
+{
+	this->offsets.push_back(Place(contact));
+	this->ids.push_back(contact.id);
+	this->nameLengths.push_back(static_cast<uint32_t>(contact.name.size()));
+	this->surnameLengths.push_back(static_cast<uint32_t>(contact.surname.size()));
+	this->phoneLengths.push_back(static_cast<uint32_t>(contact.phoneNumber.size()));
+}
+
+void ContactStore::Set(size_t index, const ContactView & contact)
+{
+	this->offsets.at(index) = Place(contact);
+	this->ids[index] = contact.id;
+	this->nameLengths[index] = static_cast<uint32_t>(contact.name.size());
+	this->surnameLengths[index] = static_cast<uint32_t>(contact.surname.size());
+	this->phoneLengths[index] = static_cast<uint32_t>(contact.phoneNumber.size());
+}
+
+void ContactStore::Erase(size_t index)
+{
+	this->ids.erase(this->ids.begin() + index);
+	this->offsets.erase(this->offsets.begin() + index);
+	this->nameLengths.erase(this->nameLengths.begin() + index);
+	this->surnameLengths.erase(this->surnameLengths.begin() + index);
+	this->phoneLengths.erase(this->phoneLengths.begin() + index);
+}
+
+void ContactStore::MarkDeleted(size_t index) { this->ids.at(index) = 0; }
+
+void ContactStore::RemoveDeleted()
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < this->ids.size(); ++i)
+	{
+		if (this->ids[i] == 0) { continue; }
+		this->ids[kept] = this->ids[i];
+		this->offsets[kept] = this->offsets[i];
+		this->nameLengths[kept] = this->nameLengths[i];
+		this->surnameLengths[kept] = this->surnameLengths[i];
+		this->phoneLengths[kept] = this->phoneLengths[i];
+		++kept;
+	}
+	this->ids.resize(kept);
+	this->offsets.resize(kept);
+	this->nameLengths.resize(kept);
+	this->surnameLengths.resize(kept);
+	this->phoneLengths.resize(kept);
+}
+
+void ContactStore::Reserve(size_t count)
+{
+	this->ids.reserve(count);
+	this->offsets.reserve(count);
+	this->nameLengths.reserve(count);
+	this->surnameLengths.reserve(count);
+	this->phoneLengths.reserve(count);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Contacts.h"
+#include "MappedFile.h"
+
+//
+// Contacts of the database stored column by column: id, where the fields start and the three field lengths,
+// 24 bytes per contact and no allocation of its own. Name, surname and phone number follow each other
+// separated by one byte, so one offset locates all three.
+//
+// An offset below the top bit points into the memory-mapped log: loaded records are not copied at all.
+// Created and edited contacts are copied into arena chunks that never move (chunk number and position
+// packed under the top bit). Superseded edits stay in the arena until the next Map(), views handed out
+// before stay valid until then too.
+//
+
+class ContactStore
+{
+	MappedFile mapping;
+	std::vector<std::unique_ptr<char[]>> chunks;
+	size_t chunkUsed, chunkSize;
+
+	std::vector<int> ids;
+	std::vector<uint64_t> offsets;
+	std::vector<uint32_t> nameLengths, surnameLengths, phoneLengths;
+
+	uint64_t Place(const ContactView & contact);
+	const char * Address(uint64_t offset) const;
+
+public:
+	ContactStore();
+	bool Map(const std::string & fileName);
+	void Clear();
+	const char * Begin() const;
+	const char * End() const;
+
+	size_t Size() const;
+	bool Empty() const;
+	ContactView At(size_t index) const;
+	ContactView Back() const;
+	void Push(const ContactView & contact);
+	void Set(size_t index, const ContactView & contact);
+	void Erase(size_t index);
+	// deleting one by one would shift the columns every time, so replay marks and drops at the end
+	void MarkDeleted(size_t index);
+	void RemoveDeleted();
+	void Reserve(size_t count);
+};
@@ -0,0 +1,305 @@
+#include "ContactTransfer.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include "AppendFile.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFER_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define IMPORT_CHUNK (4 << 20) // input bytes parsed by one task
+#define CHUNKS_PER_THREAD 2 // chunks per thread in a window, parsed before the window goes to the log
+#define EXPORT_CHUNK (1 << 20)
+#define MAX_FIELDS 5
+
+// input bytes parsed by one task, the records starting there
+struct Chunk
+{
+	const char * begin, * end;
+	std::vector<ContactView> contacts;
+	std::deque<std::string> unescaped; // quoted fields with doubled quotes, the views point here
+	long long skipped;
+	ContactLog::ImportBlock block;
+};
+
+static unsigned FirstBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// First of the two characters at or after p, end when there is none.
+static const char * FindEither(const char * p, const char * end, char first, char second)
+{
+#ifdef TRANSFER_SSE2
+	const __m128i a = _mm_set1_epi8(first), b = _mm_set1_epi8(second);
+	for (; end - p >= 16; p += 16)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, a), _mm_cmpeq_epi8(block, b)));
+		if (mask != 0) { return p + FirstBit(mask); }
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		if (*p == first || *p == second) { return p; }
+	}
+	return end;
+}
+
+static const char * Find(const char * p, const char * end, char c)
+{
+	if (p >= end) { return end; }
+	const char * found = static_cast<const char *>(memchr(p, c, end - p));
+	return found != NULL ? found : end;
+}
+
+// Reads the field at p and leaves p at the delimiter or line break behind it.
+static std::string_view ReadField(const char ** p, const char * end, char delimiter, std::deque<std::string> * unescaped)
+{
+	const char * start = *p;
+	if (delimiter != ',' || start == end || *start != '"')
+	{
+		*p = FindEither(start, end, delimiter, '\n');
+		std::string_view field(start, *p - start);
+		if (!field.empty() && field.back() == '\r') { field.remove_suffix(1); }
+		return field;
+	}
+	const char * close = Find(++start, end, '"');
+	std::string_view field(start, close - start);
+	if (end - close > 1 && close[1] == '"')
+	{
+		std::string text;
+		for (; end - close > 1 && close[1] == '"'; close = Find(start, end, '"'))
+		{
+			text.append(start, close + 1);
+			start = close + 2;
+		}
+		text.append(start, close);
+		unescaped->push_back(std::move(text));
+		field = unescaped->back();
+	}
+	// whatever follows the closing quote up to the delimiter is dropped
+	*p = FindEither(std::min(close + 1, end), end, delimiter, '\n');
+	return field;
+}
+
+static void Parse(Chunk * chunk, char delimiter)
+{
+	std::string_view fields[MAX_FIELDS];
+	chunk->contacts.reserve((chunk->end - chunk->begin) / 24);
+	for (const char * p = chunk->begin; p < chunk->end;)
+	{
+		int count = 0;
+		while (true)
+		{
+			std::string_view field = ReadField(&p, chunk->end, delimiter, &chunk->unescaped);
+			if (count < MAX_FIELDS) { fields[count] = field; }
+			++count;
+			if (p == chunk->end || *p != delimiter) { break; }
+			++p;
+		}
+		if (p < chunk->end) { ++p; }
+		if (count == 3) { chunk->contacts.push_back(ContactView(fields[0], fields[1], fields[2], 0)); }
+		else if (count == 4) { chunk->contacts.push_back(ContactView(fields[1], fields[2], fields[3], 0)); }
+		else if (count > 1 || !fields[0].empty()) { ++chunk->skipped; }
+	}
+}
+
+// Where the first record at or after p starts; inQuotes - whether p is inside a quoted field.
+static const char * RecordStart(const char * p, const char * end, char delimiter, bool inQuotes)
+{
+	if (delimiter != ',')
+	{
+		const char * newline = Find(p, end, '\n');
+		return newline < end ? newline + 1 : end;
+	}
+	for (; p < end; ++p)
+	{
+		if (*p == '"') { inQuotes = !inQuotes; }
+		else if (*p == '\n' && !inQuotes) { return p + 1; }
+	}
+	return end;
+}
+
+// Splits the input from *p on into chunks of whole records and parses them; *p is left behind the last.
+static void ParseWindow(const char ** p, const char * end, char delimiter, int threads, std::vector<Chunk> * chunks)
+{
+	size_t rest = end - *p, count = std::min<size_t>(static_cast<size_t>(threads) * CHUNKS_PER_THREAD, (rest + IMPORT_CHUNK - 1) / IMPORT_CHUNK);
+	std::vector<const char *> bounds(count + 1), starts(count + 1);
+	for (size_t k = 0; k <= count; ++k) { bounds[k] = *p + std::min<size_t>(k * IMPORT_CHUNK, rest); }
+	// a chunk starts inside a quoted field when an odd number of quotes comes before it; doubled quotes
+	// inside a field count twice
+	std::vector<size_t> quotes(count + 1, 0);
+	if (delimiter == ',')
+	{
+		ParallelFor(count, threads, [&](size_t k) { quotes[k + 1] = std::count(bounds[k], bounds[k + 1], '"'); });
+		for (size_t k = 1; k <= count; ++k) { quotes[k] += quotes[k - 1]; }
+	}
+	starts[0] = *p;
+	ParallelFor(count, threads, [&](size_t k)
+	{
+		starts[k + 1] = bounds[k + 1] == end ? end : RecordStart(bounds[k + 1], end, delimiter, quotes[k + 1] % 2 != 0);
+	});
+	chunks->clear();
+	chunks->resize(count);
+	ParallelFor(count, threads, [&](size_t k)
+	{
+		Chunk & chunk = (*chunks)[k];
+		chunk.begin = starts[k];
+		chunk.end = starts[k + 1];
+		chunk.skipped = 0;
+		Parse(&chunk, delimiter);
+	});
+	*p = starts[count];
+}
+
+// Numbers the parsed contacts from firstId on and formats them as log records.
+static void FormatWindow(std::vector<Chunk> * chunks, int firstId, int threads)
+{
+	std::vector<int> firstIds(chunks->size());
+	for (size_t k = 0; k < chunks->size(); ++k)
+	{
+		firstIds[k] = firstId;
+		firstId += static_cast<int>((*chunks)[k].contacts.size());
+	}
+	ParallelFor(chunks->size(), threads, [&](size_t k)
+	{
+		Chunk & chunk = (*chunks)[k];
+		ContactLog::ImportBlock & block = chunk.block;
+		block.records.reserve((chunk.end - chunk.begin) + chunk.contacts.size() * 24);
+		block.rows.reserve(chunk.contacts.size());
+		int id = firstIds[k];
+		for (ContactView & contact : chunk.contacts)
+		{
+			RowEntry entry;
+			entry.offset = block.records.size();
+			entry.id = contact.id = id++;
+			ContactLog::Format(&block.records, 'C', contact);
+			entry.length = static_cast<uint32_t>(block.records.size() - entry.offset);
+			block.rows.push_back(entry);
+		}
+		std::vector<ContactView>().swap(chunk.contacts);
+		chunk.unescaped.clear();
+	});
+}
+
+static bool HasExtension(const std::string & fileName, const char * extension)
+{
+	size_t length = strlen(extension);
+	if (fileName.size() < length) { return false; }
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (tolower(static_cast<unsigned char>(fileName[fileName.size() - length + i])) != extension[i]) { return false; }
+	}
+	return true;
+}
+
+// The first field of a header names a column.
+static bool IsHeader(const char * p, const char * end, char delimiter)
+{
+	std::deque<std::string> unescaped;
+	std::string field(ReadField(&p, end, delimiter, &unescaped));
+	if (field.size() >= 3 && static_cast<unsigned char>(field[0]) == 0xEF && static_cast<unsigned char>(field[1]) == 0xBB
+		&& static_cast<unsigned char>(field[2]) == 0xBF)
+	{
+		field.erase(0, 3); // UTF-8 byte order mark
+	}
+	std::transform(field.begin(), field.end(), field.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	return field == "id" || field == "name";
+}
+
+long long ContactTransfer::Import(const std::string & fileName, ContactLog * log, int threads, long long * skipped)
+{
+	MappedFile input;
+	if (!input.Open(fileName)) { return -1; }
+	const char * p = input.Data(), * end = p + input.Size();
+	const char * separator = FindEither(p, end, '\t', '\n');
+	char delimiter = HasExtension(fileName, ".tsv") || (!HasExtension(fileName, ".csv") && separator < end && *separator == '\t') ? '\t' : ',';
+	if (p < end && IsHeader(p, end, delimiter)) { p = RecordStart(p, end, delimiter, false); }
+	threads = std::max(1, threads);
+	*skipped = 0;
+	std::vector<Chunk> chunks;
+	size_t next = 0;
+	return log->Import([&](int firstId, ContactLog::ImportBlock * block)
+	{
+		if (next == chunks.size())
+		{
+			if (p >= end) { return false; }
+			ParseWindow(&p, end, delimiter, threads, &chunks);
+			FormatWindow(&chunks, firstId, threads);
+			for (const Chunk & chunk : chunks) { *skipped += chunk.skipped; }
+			next = 0;
+		}
+		std::swap(*block, chunks[next++].block);
+		return true;
+	});
+}
+
+static void WriteField(std::string * out, std::string_view field, char delimiter)
+{
+	out->push_back(delimiter);
+	if (delimiter == ',' && field.find_first_of(",\"\r\n") != std::string_view::npos)
+	{
+		out->push_back('"');
+		for (char c : field)
+		{
+			if (c == '"') { out->push_back('"'); }
+			out->push_back(c);
+		}
+		out->push_back('"');
+		return;
+	}
+	size_t start = out->size();
+	out->append(field.data(), field.size());
+	if (delimiter != ',')
+	{
+		for (size_t i = start; i < out->size(); ++i)
+		{
+			if ((*out)[i] == '\t' || (*out)[i] == '\n' || (*out)[i] == '\r') { (*out)[i] = ' '; }
+		}
+	}
+}
+
+long long ContactTransfer::Export(const std::string & fileName, ContactCursor * cursor)
+{
+	char delimiter = HasExtension(fileName, ".tsv") ? '\t' : ',';
+	AppendFile out;
+	if (!out.Open(fileName, true)) { return -1; }
+	std::string buffer = "id";
+	WriteField(&buffer, "name", delimiter);
+	WriteField(&buffer, "surname", delimiter);
+	WriteField(&buffer, "phoneNumber", delimiter);
+	buffer.push_back('\n');
+	bool good = true;
+	size_t rows = cursor->Rows();
+	for (size_t row = 0; good && row < rows; ++row)
+	{
+		ContactView contact = cursor->Row(row);
+		char id[16];
+		buffer.append(id, std::to_chars(id, id + sizeof(id), contact.id).ptr);
+		WriteField(&buffer, contact.name, delimiter);
+		WriteField(&buffer, contact.surname, delimiter);
+		WriteField(&buffer, contact.phoneNumber, delimiter);
+		buffer.push_back('\n');
+		if (buffer.size() >= EXPORT_CHUNK)
+		{
+			good = out.Write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	}
+	good = good && out.Write(buffer.data(), buffer.size()) && out.Sync();
+	return good ? static_cast<long long>(rows) : -1;
+}
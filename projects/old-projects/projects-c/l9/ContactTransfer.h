@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include "ContactCursor.h"
+#include "ContactLog.h"
+
+//
+// Bulk import and export of contacts as CSV or TSV: one contact per line, name, surname and phone number,
+// optionally behind an id column (ignored on import, every imported contact gets a new id). CSV fields may
+// be quoted the usual way, "a ""quoted"" field, with a comma"; TSV fields are taken as they are. A first
+// line starting with an id or name column is a header.
+//
+// Import maps the file and works through it in windows of chunks, every step spread over the threads:
+// quotes are counted per chunk so each one can find where its first record starts, the chunks are parsed
+// into views of the mapping, numbered from the counts before them and formatted as log records, then go to
+// ContactLog::Import() in order, which writes them all into one new segment.
+//
+// Export streams the rows of a cursor into the file, whatever the size of the database.
+//
+
+class ContactTransfer
+{
+public:
+	// returns how many contacts were imported, -1 when the file can't be read or the log written; skipped
+	// counts the lines that were not contacts
+	static long long Import(const std::string & fileName, ContactLog * log, int threads, long long * skipped);
+	// the delimiter follows the extension, .tsv or anything else for CSV; returns the number of rows, -1
+	// when the file can't be written
+	static long long Export(const std::string & fileName, ContactCursor * cursor);
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+struct Contacts
+{
+	std::string name, surname, phoneNumber;
+	int id;
+};
+
+// Contact whose fields point into memory owned by someone else (the mapped database or an edited Contacts).
+struct ContactView
+{
+	std::string_view name, surname, phoneNumber;
+	int id;
+
+	ContactView() : id(0) {}
+	ContactView(std::string_view name, std::string_view surname, std::string_view phoneNumber, int id)
+		: name(name), surname(surname), phoneNumber(phoneNumber), id(id) {}
+	ContactView(const Contacts & contact)
+		: name(contact.name), surname(contact.surname), phoneNumber(contact.phoneNumber), id(contact.id) {}
+
+	Contacts Materialize() const { return { std::string(name), std::string(surname), std::string(phoneNumber), id }; }
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Runs task(0) .. task(count - 1) on up to threads threads, the calling one included; each thread takes
+// the next index until none are left.
+template <typename Task>
+void ParallelFor(size_t count, int threads, const Task & task)
+{
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (int t = 1; t < std::min<long long>(threads, count); ++t)
+	{
+		workers.emplace_back([&task, &next, count]()
+		{
+			for (size_t k = next++; k < count; k = next++) { task(k); }
+		});
+	}
+	for (size_t k = next++; k < count; k = next++) { task(k); }
+	for (auto & worker : workers) { worker.join(); }
+}
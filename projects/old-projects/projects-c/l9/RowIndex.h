@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+//
+// Row index kept next to every segment, db.txt.7 -> db.txt.7.rows. A new segment starts with the live
+// contacts in order (its base) followed by whatever was appended since; the index holds one entry per base
+// row - where its line starts, how long it is and the id - and closes with a trailer. Row i of the base is
+// therefore one lookup away, without replaying anything.
+//
+
+#define ROW_INDEX_MAGIC 0x31574F5244555243ULL // "CRUDROW1"
+
+struct RowEntry
+{
+	uint64_t offset;
+	int32_t id;
+	uint32_t length; // with the line break
+};
+
+struct RowTrailer
+{
+	uint64_t rows;
+	uint64_t baseLength; // where the base ends in the segment
+	int32_t maxId;
+	uint32_t ascending; // ids grow with the rows, so a row is found by id with binary search
+	uint64_t magic;
+};
+
+// Checks a mapped row index and reads its trailer.
+inline bool ReadRowTrailer(const char * data, size_t size, RowTrailer * trailer)
+{
+	if (data == NULL || size < sizeof(RowTrailer)) { return false; }
+	memcpy(trailer, data + size - sizeof(RowTrailer), sizeof(RowTrailer));
+	return trailer->magic == ROW_INDEX_MAGIC && trailer->rows == (size - sizeof(RowTrailer)) / sizeof(RowEntry)
+		&& (size - sizeof(RowTrailer)) % sizeof(RowEntry) == 0;
+}
@@ -0,0 +1,185 @@
+#include "TrigramIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <tuple>
+
+static uint32_t Pack(const std::string & word, size_t i)
+{
+	return static_cast<uint32_t>(static_cast<unsigned char>(word[i])) << 16
+		| static_cast<uint32_t>(static_cast<unsigned char>(word[i + 1])) << 8
+		| static_cast<unsigned char>(word[i + 2]);
+}
+
+static void AddTrigrams(const std::string & word, std::vector<uint32_t> * trigrams)
+{
+	for (size_t i = 0; i + 3 <= word.size(); ++i) { trigrams->push_back(Pack(word, i)); }
+}
+
+static std::string Digits(std::string_view text)
+{
+	std::string digits;
+	for (char c : text)
+	{
+		if (c >= '0' && c <= '9') { digits += c; }
+	}
+	return digits;
+}
+
+// Lowercase words of letters and digits; bytes above ASCII (UTF-8 letters) are kept as they are.
+void TrigramIndex::Words(std::string_view text, bool padded, std::vector<std::string> * words)
+{
+	std::string word;
+	for (size_t i = 0; i <= text.size(); ++i)
+	{
+		unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+		if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) { word += static_cast<char>(c); }
+		else if (c >= 'A' && c <= 'Z') { word += static_cast<char>(c - 'A' + 'a'); }
+		else if (!word.empty())
+		{
+			words->push_back(padded ? " " + word + " " : word);
+			word.clear();
+		}
+	}
+}
+
+std::vector<uint32_t> TrigramIndex::Trigrams(const ContactView & contact)
+{
+	std::vector<std::string> words;
+	std::vector<uint32_t> trigrams;
+	Words(contact.name, true, &words);
+	Words(contact.surname, true, &words);
+	std::string phone = Digits(contact.phoneNumber);
+	if (!phone.empty()) { words.push_back(" " + phone + " "); }
+	for (const auto & word : words) { AddTrigrams(word, &trigrams); }
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+	return trigrams;
+}
+
+// Words of the query are not padded, so they also match inside longer words. Words too short for a
+// trigram are anchored at the start of a word instead.
+std::vector<uint32_t> TrigramIndex::QueryTrigrams(const std::string & query)
+{
+	std::vector<std::string> words;
+	std::vector<uint32_t> trigrams;
+	bool letters = std::any_of(query.begin(), query.end(), [](char c) { return isalpha(static_cast<unsigned char>(c)) || c & 0x80; });
+	if (letters) { Words(query, false, &words); }
+	else if (!Digits(query).empty()) { words.push_back(Digits(query)); }
+	for (auto & word : words)
+	{
+		if (word.size() < 3) { word = " " + word; }
+		if (word.size() < 3) { word += " "; }
+		AddTrigrams(word, &trigrams);
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+	return trigrams;
+}
+
+void TrigramIndex::Rebuild(const ContactStore & database)
+{
+	this->postings.clear();
+	this->trigramCount.clear();
+	for (size_t i = 0; i < database.Size(); ++i) { Insert(database.At(i)); }
+}
+
+void TrigramIndex::Insert(const ContactView & contact)
+{
+	std::vector<uint32_t> trigrams = Trigrams(contact);
+	for (uint32_t trigram : trigrams)
+	{
+		std::vector<int> & ids = this->postings[trigram];
+		// ids grow on create, so this is almost always an append
+		if (ids.empty() || ids.back() < contact.id) { ids.push_back(contact.id); }
+		else
+		{
+			auto it = std::lower_bound(ids.begin(), ids.end(), contact.id);
+			if (it == ids.end() || *it != contact.id) { ids.insert(it, contact.id); }
+		}
+	}
+	this->trigramCount[contact.id] = static_cast<int>(trigrams.size());
+}
+
+void TrigramIndex::Erase(const ContactView & contact)
+{
+	for (uint32_t trigram : Trigrams(contact))
+	{
+		auto posting = this->postings.find(trigram);
+		if (posting == this->postings.end()) { continue; }
+		std::vector<int> & ids = posting->second;
+		auto it = std::lower_bound(ids.begin(), ids.end(), contact.id);
+		if (it != ids.end() && *it == contact.id) { ids.erase(it); }
+		if (ids.empty()) { this->postings.erase(posting); }
+	}
+	this->trigramCount.erase(contact.id);
+}
+
+void TrigramIndex::Update(const ContactView & before, const ContactView & after)
+{
+	if (before.name == after.name && before.surname == after.surname && before.phoneNumber == after.phoneNumber) { return; }
+	Erase(before);
+	Insert(after);
+}
+
+std::vector<int> TrigramIndex::Search(const std::string & query, size_t limit) const
+{
+	std::vector<uint32_t> trigrams = QueryTrigrams(query);
+	std::vector<const std::vector<int> *> lists;
+	for (uint32_t trigram : trigrams)
+	{
+		auto posting = this->postings.find(trigram);
+		if (posting != this->postings.end()) { lists.push_back(&posting->second); }
+	}
+	if (lists.empty() || limit == 0) { return std::vector<int>(); }
+	std::sort(lists.begin(), lists.end(), [](const std::vector<int> * a, const std::vector<int> * b) { return a->size() < b->size(); });
+	const int n = static_cast<int>(trigrams.size());
+
+	// (shared trigrams, trigrams the query does not have, id)
+	std::vector<std::tuple<int, int, int>> ranked;
+	auto rank = [&](int id, int shared) { ranked.emplace_back(-shared, this->trigramCount.at(id) - shared, id); };
+
+	std::vector<int> exact;
+	if (static_cast<int>(lists.size()) == n)
+	{
+		exact = *lists[0];
+		std::vector<int> next;
+		for (size_t l = 1; l < lists.size() && !exact.empty(); ++l)
+		{
+			next.clear();
+			std::set_intersection(exact.begin(), exact.end(), lists[l]->begin(), lists[l]->end(), std::back_inserter(next));
+			exact.swap(next);
+		}
+	}
+	if (exact.size() >= limit || n < 2)
+	{
+		for (int id : exact) { rank(id, n); }
+	}
+	else
+	{
+		// a contact sharing threshold of the n trigrams is in one of the n - threshold + 1 shortest lists,
+		// so only those are scanned and the long ones are probed by binary search
+		const int threshold = std::max((n + 1) / 2, n - 4);
+		const size_t scanned = std::min(lists.size(), static_cast<size_t>(n - threshold + 1));
+		std::unordered_map<int, int> shared;
+		for (size_t l = 0; l < scanned; ++l)
+		{
+			for (int id : *lists[l]) { ++shared[id]; }
+		}
+		for (const auto & candidate : shared)
+		{
+			int count = candidate.second;
+			for (size_t l = scanned; l < lists.size() && count + static_cast<int>(lists.size() - l) >= threshold; ++l)
+			{
+				if (std::binary_search(lists[l]->begin(), lists[l]->end(), candidate.first)) { ++count; }
+			}
+			if (count >= threshold) { rank(candidate.first, count); }
+		}
+	}
+
+	limit = std::min(limit, ranked.size());
+	std::partial_sort(ranked.begin(), ranked.begin() + limit, ranked.end());
+	std::vector<int> ids;
+	for (size_t i = 0; i < limit; ++i) { ids.push_back(std::get<2>(ranked[i])); }
+	return ids;
+}
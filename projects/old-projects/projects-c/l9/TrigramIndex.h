@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ContactStore.h"
+
+//
+// Inverted index from trigrams (three consecutive lowercase characters) to the sorted ids of contacts
+// containing them. Name and surname are indexed as words padded with spaces, the phone number as its
+// digits only, so "+48 777-666" and "48777666" look the same.
+//
+// Search() takes the trigrams of the query and intersects their posting lists, smallest first: contacts
+// that hold all of them contain the query (a substring, a prefix or the whole word). When that does not
+// fill the result, contacts sharing enough trigrams are counted in as well: a wrong letter destroys at
+// most three of them, two swapped letters four. Results are ranked by shared trigrams, then by how little
+// else the contact contains.
+//
+
+class TrigramIndex
+{
+	std::unordered_map<uint32_t, std::vector<int>> postings;
+	std::unordered_map<int, int> trigramCount;
+
+	static void Words(std::string_view text, bool padded, std::vector<std::string> * words);
+	static std::vector<uint32_t> Trigrams(const ContactView & contact);
+	static std::vector<uint32_t> QueryTrigrams(const std::string & query);
+
+public:
+	void Rebuild(const ContactStore & database);
+	void Insert(const ContactView & contact);
+	void Erase(const ContactView & contact);
+	void Update(const ContactView & before, const ContactView & after);
+
+	// ids of the best matching contacts, best first
+	std::vector<int> Search(const std::string & query, size_t limit) const;
+};
@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AppendFile.h"
+#include "ContactCursor.h"
+#include "ContactIndex.h"
+#include "ContactLog.h"
+#include "ContactSnapshot.h"
+#include "ContactStore.h"
+#include "Contacts.h"
+#include "TrigramIndex.h"
+#define TIME_BUDGET 2.0 // seconds per workload, at least one operation always runs
+#define RELOADS 5
+#define LEGACY_LIMIT 1000000 // every legacy edit rewrites and rereads the whole file, bigger ones take minutes
+#define IMPORT_BLOCK 65536 // contacts per block handed to ContactLog::Import
+#define READ_SHARE 95 // percent of lookups in read-mostly
+#define DELETE_SHARE 75 // percent of deletes in delete-heavy, the rest are creates
+
+//
+// Workload benchmark for the l9 storage, built separately from main.cpp.
+// Usage: bench [max exponent = 6] [operations per workload = 10000]
+// For every size 10^3 .. 10^max contacts each backend is filled and run through the workloads, doing the
+// same work as the CRUD menu does:
+// bulk       - filling the empty database at once (the legacy Save, ContactLog::Import)
+// reload     - ReadAll, reading the whole database with its indexes
+// create, update, delete-heavy (with some creates), read-mostly (lookups by id with some updates)
+// snapshot   - log backends only: a reader refreshing a ContactSnapshot while another thread keeps updating;
+//              the reader shares only the files with the writer, as a reporting process does
+// Backends:
+// legacy     - the original storage: every edit saves the four-lines-per-contact file whole and reads it back
+// log        - the append-only log with indexes, every edit waits for its sync
+// log-group  - the same as CRUD uses it: edits are only written for the cursor, the committer thread syncs
+//              them in groups
+// Reported: operations per second, latency percentiles and bytes written to files per operation, compaction
+// included. Workloads stop after the operation count or TIME_BUDGET.
+//
+
+class Backend
+{
+public:
+	virtual ~Backend() {}
+	virtual void Fill(const std::vector<Contacts> & contacts) = 0;
+	virtual void Reload() = 0;
+	virtual void Create(Contacts contact) = 0;
+	virtual void Update(size_t position, const Contacts & contact) = 0;
+	virtual void Delete(size_t position) = 0;
+	virtual int Find(int id) = 0; // position, -1 when there is none
+	virtual size_t Size() = 0;
+	virtual int IdAt(size_t position) = 0;
+};
+
+class LegacyBackend : public Backend
+{
+	std::string fileName;
+	std::vector<Contacts> database;
+
+	void Save()
+	{
+		std::string content;
+		for (size_t i = 0; i < this->database.size(); ++i)
+		{
+			const Contacts & contact = this->database[i];
+			content += std::to_string(contact.id) + "\n" + contact.name + "\n" + contact.surname + "\n" + contact.phoneNumber;
+			if (i + 1 < this->database.size()) { content += "\n"; }
+		}
+		AppendFile out;
+		if (!out.Open(this->fileName, true) || !out.Write(content.data(), content.size())) throw new std::exception("Save() - can't open file.");
+	}
+
+public:
+	explicit LegacyBackend(std::string fileName) : fileName(fileName) {}
+	~LegacyBackend() { remove(this->fileName.c_str()); }
+
+	void Fill(const std::vector<Contacts> & contacts)
+	{
+		this->database = contacts;
+		Save();
+	}
+
+	void Reload()
+	{
+		this->database.clear();
+		std::ifstream file(this->fileName, std::ios::in);
+		if (!file.good()) throw new std::exception("Read() - can't open file.");
+		Contacts contact;
+		std::string id;
+		while (std::getline(file, id) && std::getline(file, contact.name) && std::getline(file, contact.surname))
+		{
+			std::getline(file, contact.phoneNumber);
+			contact.id = atoi(id.c_str());
+			this->database.push_back(contact);
+		}
+	}
+
+	void Create(Contacts contact)
+	{
+		contact.id = this->database.empty() ? 1 : this->database.back().id + 1;
+		this->database.push_back(contact);
+		Save();
+		Reload();
+	}
+
+	void Update(size_t position, const Contacts & contact)
+	{
+		int id = this->database[position].id;
+		this->database[position] = contact;
+		this->database[position].id = id;
+		Save();
+		Reload();
+	}
+
+	void Delete(size_t position)
+	{
+		this->database.erase(this->database.begin() + position);
+		Save();
+		Reload();
+	}
+
+	int Find(int id)
+	{
+		auto found = std::find_if(this->database.begin(), this->database.end(), [id](const Contacts & contact) { return contact.id == id; });
+		return found == this->database.end() ? -1 : static_cast<int>(found - this->database.begin());
+	}
+
+	size_t Size() { return this->database.size(); }
+	int IdAt(size_t position) { return this->database[position].id; }
+};
+
+// The loaded CRUD: store, indexes, the log and the cursor kept in step.
+class LogBackend : public Backend
+{
+	std::string fileName;
+	bool durable;
+	ContactLog log;
+	ContactCursor cursor;
+	ContactStore database;
+	ContactIndex lookup;
+	TrigramIndex fuzzy;
+	int maxId;
+
+	void Saved()
+	{
+		if (this->durable) { this->log.Sync(); }
+		else { this->log.Flush(); }
+		this->cursor.Refresh();
+	}
+
+public:
+	LogBackend(std::string fileName, bool durable) : fileName(fileName), durable(durable), log(fileName), cursor(fileName), maxId(0)
+	{
+		std::ofstream(fileName, std::ios::out | std::ios::trunc).close();
+		Reload();
+	}
+
+	void Fill(const std::vector<Contacts> & contacts)
+	{
+		size_t next = 0;
+		this->log.Import([&](int firstId, ContactLog::ImportBlock * block)
+		{
+			if (next == contacts.size()) { return false; }
+			for (size_t end = std::min(contacts.size(), next + IMPORT_BLOCK); next < end; ++next)
+			{
+				ContactView contact = contacts[next];
+				RowEntry entry;
+				entry.offset = block->records.size();
+				entry.id = contact.id = firstId++;
+				ContactLog::Format(&block->records, 'C', contact);
+				entry.length = static_cast<uint32_t>(block->records.size() - entry.offset);
+				block->rows.push_back(entry);
+			}
+			return true;
+		});
+		Reload();
+	}
+
+	void Reload()
+	{
+		this->log.Load(&this->database);
+		this->lookup.Rebuild(this->database);
+		this->fuzzy.Rebuild(this->database);
+		if (!this->cursor.Open()) throw new std::exception("Read() - can't open file.");
+		this->maxId = this->cursor.MaxId();
+	}
+
+	void Create(Contacts contact)
+	{
+		contact.id = ++this->maxId;
+		this->database.Push(contact);
+		this->lookup.Insert(this->database.Back());
+		this->fuzzy.Insert(this->database.Back());
+		this->log.AppendCreate(contact);
+		Saved();
+	}
+
+	void Update(size_t position, const Contacts & contact)
+	{
+		Contacts changed = contact;
+		ContactView before = this->database.At(position);
+		changed.id = before.id;
+		this->database.Set(position, changed);
+		this->lookup.Update(before, this->database.At(position));
+		this->fuzzy.Update(before, this->database.At(position));
+		this->log.AppendUpdate(changed);
+		Saved();
+	}
+
+	void Delete(size_t position)
+	{
+		this->log.AppendDelete(this->database.At(position).id);
+		this->lookup.Erase(this->database, position);
+		this->fuzzy.Erase(this->database.At(position));
+		this->database.Erase(position);
+		Saved();
+	}
+
+	int Find(int id) { return this->lookup.Find(id); }
+	size_t Size() { return this->database.Size(); }
+	int IdAt(size_t position) { return this->database.At(position).id; }
+};
+
+// Removes the manifest of a log database and its current segment.
+void RemoveLog(const std::string & fileName)
+{
+	unsigned long long generation;
+	if (ContactLog::ReadManifest(fileName, &generation))
+	{
+		remove(ContactLog::SegmentName(fileName, generation).c_str());
+		remove(ContactLog::RowsName(ContactLog::SegmentName(fileName, generation)).c_str());
+	}
+	remove(fileName.c_str());
+}
+
+Contacts RandomContact(std::mt19937_64 & random)
+{
+	static const char * syllables[] = { "ko", "wal", "ski", "no", "wak", "wi", "snie", "ma", "zur", "lew", "and", "dow", "icz", "ryb", "ka" };
+	static const char * names[] = { "Jan", "Anna", "Piotr", "Maria", "Krzysztof", "Katarzyna", "Andrzej", "Ewa", "Tomasz", "Zofia" };
+	Contacts contact;
+	contact.id = 0;
+	contact.name = names[random() % 10];
+	for (int i = 2 + random() % 3; i > 0; --i) { contact.surname += syllables[random() % 15]; }
+	contact.surname[0] = static_cast<char>(contact.surname[0] - 'a' + 'A');
+	contact.phoneNumber = std::to_string(500000000 + random() % 400000000);
+	return contact;
+}
+
+struct Result
+{
+	long long ops;
+	double seconds;
+	std::vector<double> latencies;
+	unsigned long long bytes;
+};
+
+Result Run(long long maxOps, const std::function<void()> & operation)
+{
+	Result result = { 0, 0, {}, 0 };
+	unsigned long long written = AppendFile::Written();
+	auto start = std::chrono::steady_clock::now();
+	while (result.ops < maxOps && (result.ops == 0 || result.seconds < TIME_BUDGET))
+	{
+		auto before = std::chrono::steady_clock::now();
+		operation();
+		auto after = std::chrono::steady_clock::now();
+		result.latencies.push_back(std::chrono::duration<double>(after - before).count());
+		result.seconds = std::chrono::duration<double>(after - start).count();
+		++result.ops;
+	}
+	result.bytes = AppendFile::Written() - written;
+	return result;
+}
+
+void Report(long long contacts, const char * backend, const char * workload, Result & result)
+{
+	std::sort(result.latencies.begin(), result.latencies.end());
+	auto percentile = [&result](double share) { return result.latencies[static_cast<size_t>(share * (result.latencies.size() - 1))] * 1e6; };
+	printf("%10lld  %-10s %-12s %9lld %12.0f %11.1f %11.1f %12.0f\n", contacts, backend, workload, result.ops,
+		result.ops / std::max(result.seconds, 1e-9), percentile(0.5), percentile(0.99), static_cast<double>(result.bytes) / result.ops);
+}
+
+void Bench(long long contacts, const char * name, Backend * backend, long long maxOps, std::mt19937_64 & random)
+{
+	std::vector<Contacts> fill;
+	for (long long i = 0; i < contacts; ++i) { fill.push_back(RandomContact(random)); }
+	// bulk loading is one operation, reported per contact
+	Result bulk = Run(1, [&]() { backend->Fill(fill); });
+	bulk.latencies.assign(1, bulk.seconds / contacts);
+	bulk.seconds /= contacts;
+	bulk.bytes /= contacts;
+	Report(contacts, name, "bulk", bulk);
+	std::vector<Contacts>().swap(fill);
+
+	Result result = Run(RELOADS, [&]() { backend->Reload(); });
+	Report(contacts, name, "reload", result);
+	result = Run(maxOps, [&]() { backend->Create(RandomContact(random)); });
+	Report(contacts, name, "create", result);
+	result = Run(maxOps, [&]() { backend->Update(random() % backend->Size(), RandomContact(random)); });
+	Report(contacts, name, "update", result);
+	result = Run(maxOps, [&]()
+	{
+		if (random() % 100 < READ_SHARE)
+		{
+			if (backend->Find(backend->IdAt(random() % backend->Size())) < 0) throw new std::exception("Find() - contact lost.");
+		}
+		else { backend->Update(random() % backend->Size(), RandomContact(random)); }
+	});
+	Report(contacts, name, "read-mostly", result);
+	result = Run(std::min<long long>(maxOps, contacts), [&]()
+	{
+		if (random() % 100 < DELETE_SHARE && backend->Size() > 1) { backend->Delete(random() % backend->Size()); }
+		else { backend->Create(RandomContact(random)); }
+	});
+	Report(contacts, name, "delete-heavy", result);
+}
+
+void BenchSnapshot(long long contacts, const char * name, Backend * backend, const std::string & fileName, long long maxOps)
+{
+	// updates only, so every state the reader sees holds the same contacts
+	size_t size = backend->Size();
+	std::atomic<bool> stop(false);
+	std::thread writer([&]()
+	{
+		std::mt19937_64 random(2);
+		while (!stop) { backend->Update(random() % size, RandomContact(random)); }
+	});
+	ContactSnapshot snapshot(fileName);
+	if (!snapshot.Open()) throw new std::exception("ContactSnapshot - can't open file.");
+	unsigned long long generation = snapshot.Generation(), length = snapshot.Length();
+	Result result = Run(maxOps, [&]()
+	{
+		snapshot.Refresh();
+		bool older = snapshot.Generation() < generation || (snapshot.Generation() == generation && snapshot.Length() < length);
+		if (snapshot.Contacts().Size() != size || older) throw new std::exception("ContactSnapshot - inconsistent state.");
+		generation = snapshot.Generation();
+		length = snapshot.Length();
+	});
+	stop = true;
+	writer.join();
+	Report(contacts, name, "snapshot", result);
+}
+
+int main(int argc, char * argv[])
+{
+	int maxExponent = argc > 1 ? atoi(argv[1]) : 6;
+	long long maxOps = argc > 2 ? atoll(argv[2]) : 10000;
+	std::mt19937_64 random(1);
+
+	printf("%10s  %-10s %-12s %9s %12s %11s %11s %12s\n", "contacts", "backend", "workload", "ops", "ops/s", "p50 [us]", "p99 [us]", "bytes/op");
+	for (int exponent = 3; exponent <= maxExponent; ++exponent)
+	{
+		long long contacts = 1;
+		for (int e = 0; e < exponent; ++e) { contacts *= 10; }
+		if (contacts <= LEGACY_LIMIT)
+		{
+			LegacyBackend legacy("bench_legacy.txt");
+			Bench(contacts, "legacy", &legacy, maxOps, random);
+		}
+		{
+			LogBackend log("bench_log.txt", true);
+			Bench(contacts, "log", &log, maxOps, random);
+			BenchSnapshot(contacts, "log", &log, "bench_log.txt", maxOps);
+		}
+		RemoveLog("bench_log.txt");
+		{
+			LogBackend log("bench_log.txt", false);
+			Bench(contacts, "log-group", &log, maxOps, random);
+			BenchSnapshot(contacts, "log-group", &log, "bench_log.txt", maxOps);
+		}
+		RemoveLog("bench_log.txt");
+	}
+	return 0;
+}
@@ -1,7 +1,39 @@
+#include <iostream>
+#include <string>
 #include "CRUD.h"
+#include "ContactSnapshot.h"
+#define REPORT_LIMIT 50
 
-int main()
+//
+// Usage: l9                          - the editor
+//        l9 --report [surname prefix] - read-only report, any number of them can run next to the editor
+//
+
+// Contacts whose surname starts with prefix in a snapshot of the database; reads the files only, so the
+// editor goes on without waiting for it.
+int Report(const std::string & fileName, const std::string & prefix)
+{
+	ContactSnapshot snapshot(fileName);
+	if (!snapshot.Open())
+	{
+		std::cout << "Can't open " << fileName << " (open it in the editor once to convert it)." << std::endl;
+		return 1;
+	}
+	const ContactStore & contacts = snapshot.Contacts();
+	size_t matching = 0;
+	for (size_t i = 0; i < contacts.Size(); ++i)
+	{
+		ContactView contact = contacts.At(i);
+		if (contact.surname.substr(0, prefix.size()) != prefix) { continue; }
+		if (++matching <= REPORT_LIMIT) { std::cout << contact.id << "\t" << contact.surname << " " << contact.name << "\t" << contact.phoneNumber << std::endl; }
+	}
+	std::cout << matching << " of " << contacts.Size() << " contacts, version " << snapshot.Generation() << "." << snapshot.Length() << std::endl;
+	return 0;
+}
+
+int main(int argc, char * argv[])
 {
+	if (argc > 1 && std::string(argv[1]) == "--report") { return Report("db.txt", argc > 2 ? argv[2] : ""); }
 	CRUD sys("db.txt");
 	sys.Menu();
 }